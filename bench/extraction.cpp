@@ -0,0 +1,286 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+/*
+Extraction benchmarks, everything runs offline on corpora generated at startup (the same
+ones on every run) in a temporary directory that is removed at the end:
+    dense_html    URL on almost every line
+    sparse_c      C sources, a URL in a comment once in a while
+    minified_js   one huge line, a few URLs
+    tiny_files    thousands of small files in a directory tree, also used for walking
+
+Scan_*     URLScanner alone on text in memory, the raw speed of the matcher
+Markup_*   MarkupScanner on dense_html and on docs_md (Markdown pages with relative links,
+           headings and code blocks), the links and anchors tokenizer alone
+Extract_*  Checker::extractURLS() on files: mapping, chunking, the pool and the merge
+Dedup      URLIndex on the URLs of dense_html, one in four written another way
+Walk       DirectoryWalker over the tiny_files tree, with 1 thread and one per core
+
+Files are read through the page cache after the first iteration, so Extract_* and Walk
+measure the CPU side, not the disk.
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <checker.h>
+#include <walker.h>
+
+using namespace std;
+namespace fs = filesystem;
+
+namespace {
+    const size_t corpusSize = 8 << 20; //Bytes of each generated text
+    const int treeFanout    = 6;       //Subdirectories per directory
+    const int treeDepth     = 3;
+    const int filesPerDir   = 16;
+
+    string denseHTML(size_t size)
+    {
+        mt19937 random(1);
+        string text = "<!DOCTYPE html>\n<html><body><ul>\n";
+        while (text.size() < size) {
+            const string host = to_string(random() % 50), page = to_string(random() % 500);
+            text += "<li><a href=\"https://www.site" + host + ".example.com/docs/page" + page +
+                    ".html?ref=list#top\">Page " + page + "</a></li>\n";
+        }
+        return text + "</ul></body></html>\n";
+    }
+
+    string sparseC(size_t length)
+    {
+        static const char *const lines[] = {
+            "    for (size_t i = 0; i < count; i++) total += values[i] * weights[i];\n",
+            "    if (!buffer || length == 0) return -1; /* nothing to do */\n",
+            "static int compare(const void *a, const void *b) { return *(int*)a - *(int*)b; }\n",
+            "    memcpy(out + written, chunk.data, chunk.size); written += chunk.size;\n",
+            "\n",
+            "}\n",
+        };
+        mt19937 random(2);
+        string text = "#include <stdio.h>\n#include <string.h>\n\n";
+        for (size_t line = 0; text.size() < length; line++) {
+            if (line % 300 == 299) text += "/* See http://docs.example.org/api/v2/func" + to_string(random() % 1000) + ".html for details. */\n";
+            else text += lines[random() % size(lines)];
+        }
+        return text;
+    }
+
+    string minifiedJS(size_t size)
+    {
+        mt19937 random(3);
+        string text = "!function(e){";
+        for (size_t n = 0; text.size() < size; n++) {
+            const string id = to_string(random() % 100000);
+            if (n % 64 == 63) text += "fetch(\"https://cdn.example.net/lib/v3/m" + id + ".min.js\").then(r=>r.json());";
+            else text += "var a" + id + "=function(b,c){return b.map(function(d){return d*c+" + id + "})},";
+        }
+        return text + "}(window);\n";
+    }
+
+    string docsMarkdown(size_t size)
+    {
+        mt19937 random(5);
+        string text;
+        for (size_t n = 0; text.size() < size; n++) {
+            const string page = to_string(random() % 500);
+            text += "## Section " + to_string(n) + "\n\nSee [page " + page + "](../guide/page" + page + ".md#usage) and " +
+                    "![diagram](img/d" + page + ".png \"Diagram\") for the details, `code` and <a href=\"api.html#f" +
+                    page + "\">the API</a>.\n\n```\nint main() { return 0; }\n```\n\n";
+        }
+        return text;
+    }
+
+    string tinyFile(mt19937 &random)
+    {
+        const string id = to_string(random() % 100000);
+        return "# Notes " + id + "\n\nShort page, one link: https://example.com/notes/" + id +
+               "\nand some text after it to look like a real file.\n";
+    }
+
+    void writeFile(const fs::path &path, const string &text)
+    {
+        ofstream(path, ios::binary).write(text.data(), text.size());
+    }
+
+    void makeTree(const fs::path &dir, int depth, mt19937 &random, vector<string> &files)
+    {
+        fs::create_directories(dir);
+        for (int f = 0; f < filesPerDir; f++) {
+            const fs::path file = dir / ("file" + to_string(f) + ".md");
+            writeFile(file, tinyFile(random));
+            files.push_back(file.string());
+        }
+        if (depth == 0) return;
+        for (int d = 0; d < treeFanout; d++) makeTree(dir / ("dir" + to_string(d)), depth - 1, random, files);
+    }
+}
+
+//Generated once, the first time a benchmark needs them
+class Corpora
+{
+public:
+    static const Corpora &get()
+    {
+        static Corpora corpora;
+        return corpora;
+    }
+
+    string dense, sparse, minified, docs;
+    vector<string> denseFiles, sparseFiles, minifiedFiles, tinyFiles;
+    string tree;
+
+    ~Corpora()
+    {
+        error_code failed;
+        fs::remove_all(root, failed);
+    }
+
+private:
+    Corpora() :
+        dense(denseHTML(corpusSize)), sparse(sparseC(corpusSize)), minified(minifiedJS(corpusSize)),
+        docs(docsMarkdown(corpusSize))
+    {
+        root = fs::temp_directory_path() / ("fud_bench." + to_string(random_device()()));
+        fs::create_directories(root);
+
+        writeFile(root / "dense.html", dense);
+        writeFile(root / "sparse.c", sparse);
+        writeFile(root / "minified.js", minified);
+        denseFiles    = { (root / "dense.html").string() };
+        sparseFiles   = { (root / "sparse.c").string() };
+        minifiedFiles = { (root / "minified.js").string() };
+
+        mt19937 random(4);
+        tree = (root / "tree").string();
+        makeTree(tree, treeDepth, random, tinyFiles);
+    }
+
+    fs::path root;
+};
+
+static void Scan(benchmark::State &state, string Corpora::*corpus)
+{
+    const string &text = Corpora::get().*corpus;
+    size_t found = 0;
+    for (auto _: state) {
+        URLMatch match;
+        size_t from = 0, URLs = 0;
+        while (URLScanner::find(text.data(), text.size(), from, match)) {
+            from = match.offset + match.length;
+            URLs++;
+        }
+        benchmark::DoNotOptimize(URLs);
+        found += URLs;
+    }
+    state.SetBytesProcessed(state.iterations() * text.size());
+    state.counters["URLs"] = benchmark::Counter(found, benchmark::Counter::kIsRate);
+}
+BENCHMARK_CAPTURE(Scan, dense_html, &Corpora::dense)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(Scan, sparse_c, &Corpora::sparse)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(Scan, minified_js, &Corpora::minified)->Unit(benchmark::kMillisecond);
+
+static void Markup(benchmark::State &state, string Corpora::*corpus, MarkupScanner::Kind kind)
+{
+    const string &text = Corpora::get().*corpus;
+    size_t found = 0;
+    for (auto _: state) {
+        vector<MarkupScanner::Link> links;
+        string base;
+        MarkupScanner::links(text.data(), text.size(), kind, links, base);
+        found += links.size();
+    }
+    state.SetBytesProcessed(state.iterations() * text.size());
+    state.counters["links"] = benchmark::Counter(found, benchmark::Counter::kIsRate);
+}
+BENCHMARK_CAPTURE(Markup, dense_html, &Corpora::dense, MarkupScanner::HTML)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(Markup, docs_md, &Corpora::docs, MarkupScanner::Markdown)->Unit(benchmark::kMillisecond);
+
+static void Extract(benchmark::State &state, vector<string> Corpora::*corpus)
+{
+    const vector<string> &files = Corpora::get().*corpus;
+    uintmax_t bytes = 0;
+    for (const auto &file: files) bytes += fs::file_size(file);
+
+    size_t found = 0;
+    for (auto _: state) {
+        Checker checker(files, ScanOptions());
+        found += checker.extractURLS().occurrences.size();
+    }
+    state.SetBytesProcessed(state.iterations() * bytes);
+    state.counters["URLs"]  = benchmark::Counter(found, benchmark::Counter::kIsRate);
+    state.counters["files"] = benchmark::Counter(state.iterations() * files.size(), benchmark::Counter::kIsRate);
+}
+BENCHMARK_CAPTURE(Extract, dense_html, &Corpora::denseFiles)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(Extract, sparse_c, &Corpora::sparseFiles)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(Extract, minified_js, &Corpora::minifiedFiles)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(Extract, tiny_files, &Corpora::tinyFiles)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+//Argument: 1 when near-duplicates are checked separately (--duplicatecheck)
+static void Dedup(benchmark::State &state)
+{
+    const string &text = Corpora::get().dense;
+    vector<FoundLink> links;
+    uint64_t bytes = 0;
+    URLMatch match;
+    for (size_t from = 0; URLScanner::find(text.data(), text.size(), from, match); from = match.offset + match.length) {
+        string URL = text.substr(match.offset, match.length);
+        //Same URLs written differently: upper case host, default port
+        if (links.size() % 4 == 1) URL.replace(0, 12, "HTTPS://WWW.");
+        else if (links.size() % 4 == 3) URL.insert(URL.find('/', 8), ":443");
+        bytes += URL.size();
+        links.push_back({0, (long)links.size(), 1, move(URL)});
+    }
+
+    size_t unique = 0;
+    for (auto _: state) {
+        state.PauseTiming();
+        vector<FoundLink> batch = links;
+        state.ResumeTiming();
+
+        URLIndex index(state.range(0) != 0);
+        for (auto &link: batch) index.add(move(link));
+        unique = index.uniqueURLs();
+    }
+    state.SetBytesProcessed(state.iterations() * bytes);
+    state.counters["URLs"]   = benchmark::Counter(state.iterations() * links.size(), benchmark::Counter::kIsRate);
+    state.counters["unique"] = unique;
+}
+BENCHMARK(Dedup)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+//Argument: threads listing the directories, 0 = one per core
+static void Walk(benchmark::State &state)
+{
+    const string &tree = Corpora::get().tree;
+    WalkOptions options;
+    options.recursive = true;
+    options.threads   = state.range(0) > 0 ? state.range(0) : ThreadPool::defaultThreads();
+
+    size_t found = 0;
+    for (auto _: state) {
+        vector<string> files, errors;
+        DirectoryWalker(options).walk(tree, files, errors);
+        found += files.size();
+    }
+    state.counters["files"] = benchmark::Counter(found, benchmark::Counter::kIsRate);
+}
+BENCHMARK(Walk)->Arg(1)->Arg(0)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,430 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+/*
+End-to-end load harness: a mock HTTP server runs in this process on a few local ports (each
+port is a host for FUD's per-host limits), a corpus of URLs pointing at it is generated and
+the FUD binary checks it with a JSON Lines report. Nothing leaves the machine.
+
+    fud_load [--urls=N] [--hosts=N] [--latency=MS] [--jitter=MS] [--redirects=N]
+             [--mix=KIND:WEIGHT,...] [--fud=PATH] [-- FUD arguments...]
+
+Kinds of URLs in the mix:
+    ok        200 after --latency (+ up to --jitter) milliseconds
+    404, 500  any status code, after the same latency
+    redirect  a chain of --redirects 302s ending on a 200
+    limited   429 with "Retry-After: 1" twice, then 200
+    stall     headers never sent, until FUD gives up on the connection
+    reset     the connection is reset (RST) without an answer
+The default mix is ok:90,404:4,redirect:2,limited:2,stall:1,reset:1. FUD gets --timeout=5,
+arguments after "--" are passed as is and win over it (--jobs, --per-host, --breaker...).
+
+Reported: requests served per second, URLs checked per second, p50/p99 of the time FUD took
+per URL (retries included), the statuses it found, its CPU time and peak resident memory.
+*/
+
+#ifdef WIN32
+
+#include <iostream>
+
+int main()
+{
+    std::cerr << "fud_load needs POSIX sockets and processes, it doesn't run on Windows.\n";
+    return 1;
+}
+
+#else
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace chrono;
+namespace fs = filesystem;
+
+namespace {
+    //429 answers given to a "limited" URL before it's accepted
+    const int limitedAnswers = 2;
+}
+
+/*
+Thread per connection, keep-alive, HEAD and GET. The behavior of a request only depends on
+its path and query, so the corpus decides everything:
+    /ok  /status/CODE  /redirect/N  /limited  /stall  /reset    with ?d=MS for the latency
+*/
+class MockServer
+{
+public:
+    explicit MockServer(int hosts)
+    {
+        for (int h = 0; h < hosts; h++) {
+            const int listener = socket(AF_INET, SOCK_STREAM, 0);
+            const int yes = 1;
+            setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof yes);
+
+            sockaddr_in address = {};
+            address.sin_family      = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            address.sin_port        = 0;
+            socklen_t length = sizeof address;
+            if (listener < 0 || ::bind(listener, (sockaddr*)&address, sizeof address) != 0 ||
+                listen(listener, SOMAXCONN) != 0 || getsockname(listener, (sockaddr*)&address, &length) != 0) {
+                if (listener >= 0) close(listener);
+                continue;
+            }
+            listeners.push_back(listener);
+            ports.push_back(ntohs(address.sin_port));
+        }
+        for (const int listener: listeners) acceptors.emplace_back(&MockServer::accept, this, listener);
+    }
+
+    ~MockServer()
+    {
+        stopping = true;
+        for (const int listener: listeners) shutdown(listener, SHUT_RDWR);
+        for (auto &acceptor: acceptors) acceptor.join();
+        for (const int listener: listeners) close(listener);
+
+        vector<thread> finished;
+        {
+            lock_guard<mutex> guard(lock);
+            for (const int client: clients) shutdown(client, SHUT_RDWR);
+            finished.swap(connections);
+        }
+        for (auto &connection: finished) connection.join();
+    }
+
+    vector<int> ports;
+    atomic<size_t> requests{0};
+    atomic<size_t> connectionsOpened{0};
+
+private:
+    void accept(int listener)
+    {
+        while (!stopping) {
+            const int client = ::accept(listener, nullptr, nullptr);
+            if (client < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                return;
+            }
+            connectionsOpened++;
+            lock_guard<mutex> guard(lock);
+            clients.push_back(client);
+            connections.emplace_back(&MockServer::serve, this, client);
+        }
+    }
+
+    void serve(int client)
+    {
+        string buffer;
+        char data[4096];
+        while (!stopping) {
+            size_t end;
+            while ((end = buffer.find("\r\n\r\n")) == string::npos) {
+                const ssize_t got = recv(client, data, sizeof data, 0);
+                if (got <= 0) return forget(client);
+                buffer.append(data, got);
+            }
+            const string head = buffer.substr(0, end);
+            buffer.erase(0, end + 4);
+            requests++;
+
+            const size_t space = head.find(' '), second = head.find(' ', space + 1);
+            if (space == string::npos || second == string::npos) return forget(client);
+            if (!answer(client, head.substr(0, space), head.substr(space + 1, second - space - 1))) return forget(client);
+        }
+        forget(client);
+    }
+
+    //False when the connection is over
+    bool answer(int client, const string &method, const string &target)
+    {
+        const size_t question = target.find('?');
+        const string path  = target.substr(0, question);
+        const string query = question == string::npos ? string() : target.substr(question + 1);
+
+        const string delay = parameter(query, "d");
+        if (!delay.empty()) this_thread::sleep_for(milliseconds(atol(delay.c_str())));
+
+        if (path == "/stall") {
+            //Until the client gives up, or the harness stops
+            pollfd wait = { client, POLLIN, 0 };
+            while (!stopping && poll(&wait, 1, 100) == 0) {}
+            return false;
+        }
+        if (path == "/reset") {
+            const linger abort = { 1, 0 };
+            setsockopt(client, SOL_SOCKET, SO_LINGER, &abort, sizeof abort);
+            return false;
+        }
+
+        int code = 200;
+        string extra;
+        if (path.compare(0, 8, "/status/") == 0) code = atoi(path.c_str() + 8);
+        else if (path.compare(0, 10, "/redirect/") == 0) {
+            const int left = atoi(path.c_str() + 10);
+            if (left > 0) {
+                code  = 302;
+                extra = "Location: /redirect/" + to_string(left - 1) + (query.empty() ? "" : "?" + query) + "\r\n";
+            }
+        }
+        else if (path == "/limited") {
+            lock_guard<mutex> guard(lock);
+            if (limited[query]++ < limitedAnswers) {
+                code  = 429;
+                extra = "Retry-After: 1\r\n";
+            }
+        }
+        else if (path != "/ok") code = 404;
+
+        const string body = "mock\n";
+        string response = "HTTP/1.1 " + to_string(code) + " Mock\r\n" + extra +
+                          "Content-Length: " + to_string(body.size()) + "\r\n\r\n";
+        if (method != "HEAD") response += body;
+        return send(client, response.data(), response.size(), MSG_NOSIGNAL) == (ssize_t)response.size();
+    }
+
+    static string parameter(const string &query, const string &name)
+    {
+        for (size_t begin = 0; begin < query.size();) {
+            const size_t end = min(query.find('&', begin), query.size());
+            if (query.compare(begin, name.size() + 1, name + "=") == 0)
+                return query.substr(begin + name.size() + 1, end - begin - name.size() - 1);
+            begin = end + 1;
+        }
+        return string();
+    }
+
+    void forget(int client)
+    {
+        lock_guard<mutex> guard(lock);
+        clients.erase(remove(clients.begin(), clients.end(), client), clients.end());
+        close(client);
+    }
+
+    vector<int>    listeners;
+    vector<thread> acceptors;
+    atomic<bool>   stopping{false};
+
+    mutex          lock;
+    vector<int>    clients;
+    vector<thread> connections;
+    map<string, int> limited; //Answers given to each "limited" URL
+};
+
+struct Options
+{
+    size_t URLs      = 2000;
+    int    hosts     = 4;
+    long   latency   = 20;
+    long   jitter    = 0;
+    int    redirects = 3;
+    vector<pair<string, int>> mix = { {"ok", 90}, {"404", 4}, {"redirect", 2}, {"limited", 2}, {"stall", 1}, {"reset", 1} };
+    string fud;
+    vector<string> fudArguments;
+};
+
+static bool parseMix(const string &list, vector<pair<string, int>> &mix)
+{
+    mix.clear();
+    size_t begin = 0;
+    while (begin < list.size()) {
+        const size_t end = min(list.find(',', begin), list.size());
+        const string item = list.substr(begin, end - begin);
+        const size_t colon = item.find(':');
+        const string kind = item.substr(0, colon);
+        const int weight = colon == string::npos ? 1 : atoi(item.c_str() + colon + 1);
+        const bool known = kind == "ok" || kind == "redirect" || kind == "limited" || kind == "stall" || kind == "reset" ||
+                           (kind.size() == 3 && all_of(kind.begin(), kind.end(), ::isdigit));
+        if (!known || weight < 0) return false;
+        if (weight > 0) mix.push_back({kind, weight});
+        begin = end + 1;
+    }
+    return !mix.empty();
+}
+
+static string makeURL(const string &kind, int port, size_t id, long delay, int redirects)
+{
+    string path;
+    if (kind == "ok" || kind == "limited" || kind == "stall" || kind == "reset") path = "/" + kind;
+    else if (kind == "redirect") path = "/redirect/" + to_string(redirects);
+    else path = "/status/" + kind;
+    return "http://127.0.0.1:" + to_string(port) + path + "?id=" + to_string(id) + "&d=" + to_string(delay);
+}
+
+//Value of "key" in a JSON Lines record of FUD, numbers and strings without escapes only
+static string field(const string &line, const string &key)
+{
+    const string name = "\"" + key + "\":";
+    size_t start = line.find(name);
+    if (start == string::npos) return string();
+    start += name.size();
+    if (line[start] == '"') {
+        const size_t end = line.find('"', start + 1);
+        return line.substr(start + 1, end - start - 1);
+    }
+    return line.substr(start, line.find_first_of(",}", start) - start);
+}
+
+static long percentile(const vector<long> &sorted, double p)
+{
+    if (sorted.empty()) return 0;
+    const size_t rank = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[min(rank, sorted.size() - 1)];
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    options.fud = (fs::path(argv[0]).parent_path() / "FUD").string();
+
+    for (int a = 1; a < argc; a++) {
+        const string arg_str(argv[a]);
+        if (arg_str == "--") {
+            options.fudArguments.assign(argv + a + 1, argv + argc);
+            break;
+        }
+        else if (arg_str.find("--urls=") == 0)      options.URLs      = atol(arg_str.c_str() + 7);
+        else if (arg_str.find("--hosts=") == 0)     options.hosts     = atoi(arg_str.c_str() + 8);
+        else if (arg_str.find("--latency=") == 0)   options.latency   = atol(arg_str.c_str() + 10);
+        else if (arg_str.find("--jitter=") == 0)    options.jitter    = atol(arg_str.c_str() + 9);
+        else if (arg_str.find("--redirects=") == 0) options.redirects = atoi(arg_str.c_str() + 12);
+        else if (arg_str.find("--fud=") == 0)       options.fud       = arg_str.substr(6);
+        else if (arg_str.find("--mix=") == 0) {
+            if (!parseMix(arg_str.substr(6), options.mix)) {
+                cerr << "Invalid mix: " << arg_str << '\n';
+                return 1;
+            }
+        }
+        else {
+            cerr << "Unknown argument: " << arg_str << " (FUD arguments go after \"--\")\n";
+            return 1;
+        }
+    }
+    if (options.URLs < 1 || options.hosts < 1 || options.latency < 0 || options.jitter < 0 || options.redirects < 0) {
+        cerr << "Numbers must be positive.\n";
+        return 1;
+    }
+    if (access(options.fud.c_str(), X_OK) != 0) {
+        cerr << "FUD binary not found: " << options.fud << " (use --fud=PATH)\n";
+        return 1;
+    }
+
+    MockServer server(options.hosts);
+    if (server.ports.empty()) {
+        cerr << "Failed to listen on a local port.\n";
+        return 1;
+    }
+
+    //The same corpus for the same options
+    const fs::path work = fs::temp_directory_path() / ("fud_load." + to_string(getpid()));
+    fs::create_directories(work);
+    const string corpus = (work / "corpus.txt").string(), report = (work / "report.jsonl").string();
+    {
+        mt19937 random(1);
+        int total = 0;
+        for (const auto &kind: options.mix) total += kind.second;
+        ofstream out(corpus);
+        for (size_t id = 0; id < options.URLs; id++) {
+            int pick = random() % total;
+            size_t k = 0;
+            while (pick >= options.mix[k].second) pick -= options.mix[k++].second;
+            const long delay = options.latency + (options.jitter > 0 ? random() % (options.jitter + 1) : 0);
+            out << "Link " << id << ": " << makeURL(options.mix[k].first, server.ports[id % server.ports.size()], id, delay, options.redirects) << '\n';
+        }
+    }
+
+    vector<string> arguments = { options.fud, corpus, "--timeout=5", "--format=jsonl", "--output=" + report };
+    arguments.insert(arguments.end(), options.fudArguments.begin(), options.fudArguments.end());
+
+    cout << "Mock server on 127.0.0.1, " << server.ports.size() << " port(s). " << options.URLs << " URL(s), latency "
+         << options.latency << " ms (+" << options.jitter << ").\nRunning:";
+    for (const auto &argument: arguments) cout << ' ' << argument;
+    cout << endl;
+
+    const auto start = steady_clock::now();
+    const pid_t child = fork();
+    if (child == 0) {
+        //Console output of FUD isn't part of the measure
+        const int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        dup2(null, STDERR_FILENO);
+        vector<char*> argv_fud;
+        for (auto &argument: arguments) argv_fud.push_back(&argument[0]);
+        argv_fud.push_back(nullptr);
+        execv(argv_fud[0], argv_fud.data());
+        _exit(127);
+    }
+    int status = 0;
+    rusage usage = {};
+    if (child < 0 || wait4(child, &status, 0, &usage) != child) {
+        cerr << "Failed to run FUD.\n";
+        fs::remove_all(work);
+        return 1;
+    }
+    const double seconds = duration<double>(steady_clock::now() - start).count();
+
+    vector<long> latencies;
+    map<string, size_t> statuses;
+    size_t timeouts = 0;
+    ifstream in(report);
+    for (string line; getline(in, line);) {
+        latencies.push_back(atol(field(line, "elapsed_ms").c_str()));
+        statuses[field(line, "status")]++;
+        if (field(line, "curl_code") == "28") timeouts++;
+    }
+    sort(latencies.begin(), latencies.end());
+    fs::remove_all(work);
+
+    const size_t served = server.requests;
+    cout << "\nFUD exit status:   " << (WIFEXITED(status) ? WEXITSTATUS(status) : -1) << '\n'
+         << "Wall time:         " << seconds << " s\n"
+         << "Requests served:   " << served << " (" << served / seconds << " per second, "
+                                  << server.connectionsOpened << " connection(s))\n"
+         << "URLs checked:      " << latencies.size() << " (" << latencies.size() / seconds << " per second)\n"
+         << "Latency per URL:   p50 " << percentile(latencies, 0.50) << " ms, p99 " << percentile(latencies, 0.99)
+                                  << " ms, max " << (latencies.empty() ? 0 : latencies.back()) << " ms\n"
+         << "Results:          ";
+    for (const auto &count: statuses) cout << ' ' << count.first << ' ' << count.second;
+    cout << ", " << timeouts << " timed out\n"
+         << "CPU time of FUD:   " << usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 << " s user, "
+                                  << usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6 << " s system\n"
+         << "Peak RSS of FUD:   " << usage.ru_maxrss / 1024.0 << " MB\n";
+
+    return latencies.size() == options.URLs ? 0 : 2;
+}
+
+#endif // WIN32
@@ -0,0 +1,186 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+/*
+Memory benchmarks: what each link costs while FUD keeps it for the report. Every allocation
+of the process goes through the counting operator new below, so the numbers don't depend
+on the allocator. Nothing is requested, it runs offline.
+    Index/N    N links added to URLIndex, which the checker keeps until the end of the run.
+               One URL out of 20 is unique, one out of 4 is written another way.
+    Extract/N  Checker::extractURLS() on a generated file of N links, one URL out of 20 unique.
+
+Counters: bytes/link  heap still held once every link is in, per link
+          peak/link   highest heap use on the way, per link
+          allocs/link allocations, per link
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <random>
+#include <string>
+
+#include <urlindex.h>
+#include <checker.h>
+
+using namespace std;
+namespace fs = filesystem;
+
+namespace {
+    atomic<size_t> liveBytes{0}, peakBytes{0}, allocations{0};
+
+    //Room for the size of each block in front of it, as much as malloc() aligns to
+    constexpr size_t headerSize = alignof(max_align_t);
+
+    void *allocate(size_t size, size_t alignment) noexcept
+    {
+        //Over-aligned blocks keep their alignment behind a header of one alignment unit
+        const size_t offset = max(alignment, headerSize);
+        void *base = alignment > headerSize ? aligned_alloc(alignment, (offset + size + alignment - 1) / alignment * alignment)
+                                            : malloc(offset + size);
+        if (!base) return nullptr;
+        const uintptr_t block = reinterpret_cast<uintptr_t>(base) + offset;
+        memcpy(reinterpret_cast<void*>(block - sizeof(size_t)), &size, sizeof(size_t));
+
+        allocations.fetch_add(1, memory_order_relaxed);
+        const size_t live = liveBytes.fetch_add(size, memory_order_relaxed) + size;
+        size_t peak = peakBytes.load(memory_order_relaxed);
+        while (live > peak && !peakBytes.compare_exchange_weak(peak, live, memory_order_relaxed)) {}
+        return reinterpret_cast<void*>(block);
+    }
+
+    void release(void *pointer, size_t alignment) noexcept
+    {
+        if (!pointer) return;
+        const uintptr_t block = reinterpret_cast<uintptr_t>(pointer);
+        size_t size;
+        memcpy(&size, reinterpret_cast<void*>(block - sizeof(size_t)), sizeof(size_t));
+        liveBytes.fetch_sub(size, memory_order_relaxed);
+        free(reinterpret_cast<void*>(block - max(alignment, headerSize)));
+    }
+
+    void *allocateOrThrow(size_t size, size_t alignment)
+    {
+        void *block = allocate(size, alignment);
+        if (!block) throw bad_alloc();
+        return block;
+    }
+
+    struct Usage
+    {
+        size_t held = 0, peak = 0, allocs = 0;
+    };
+
+    //Heap used from its construction to the call of take()
+    class Measure
+    {
+    public:
+        Measure() : bytes(liveBytes), allocs(allocations) { peakBytes = bytes; }
+
+        Usage take() const { return {liveBytes - bytes, peakBytes - bytes, allocations - allocs}; }
+
+    private:
+        size_t bytes, allocs;
+    };
+
+    void report(benchmark::State &state, const Usage &usage, size_t links)
+    {
+        state.counters["bytes/link"]  = double(usage.held) / links;
+        state.counters["peak/link"]   = double(usage.peak) / links;
+        state.counters["allocs/link"] = double(usage.allocs) / links;
+        state.counters["links"]       = benchmark::Counter(double(links) * state.iterations(), benchmark::Counter::kIsRate);
+    }
+}
+
+//Every replaceable form, the sized ones don't need the size that is kept anyway
+void *operator new(size_t size) { return allocateOrThrow(size, 0); }
+void *operator new[](size_t size) { return allocateOrThrow(size, 0); }
+void *operator new(size_t size, align_val_t alignment) { return allocateOrThrow(size, size_t(alignment)); }
+void *operator new[](size_t size, align_val_t alignment) { return allocateOrThrow(size, size_t(alignment)); }
+void *operator new(size_t size, const nothrow_t &) noexcept { return allocate(size, 0); }
+void *operator new[](size_t size, const nothrow_t &) noexcept { return allocate(size, 0); }
+void *operator new(size_t size, align_val_t alignment, const nothrow_t &) noexcept { return allocate(size, size_t(alignment)); }
+void *operator new[](size_t size, align_val_t alignment, const nothrow_t &) noexcept { return allocate(size, size_t(alignment)); }
+
+void operator delete(void *block) noexcept { release(block, 0); }
+void operator delete[](void *block) noexcept { release(block, 0); }
+void operator delete(void *block, size_t) noexcept { release(block, 0); }
+void operator delete[](void *block, size_t) noexcept { release(block, 0); }
+void operator delete(void *block, align_val_t alignment) noexcept { release(block, size_t(alignment)); }
+void operator delete[](void *block, align_val_t alignment) noexcept { release(block, size_t(alignment)); }
+void operator delete(void *block, size_t, align_val_t alignment) noexcept { release(block, size_t(alignment)); }
+void operator delete[](void *block, size_t, align_val_t alignment) noexcept { release(block, size_t(alignment)); }
+void operator delete(void *block, const nothrow_t &) noexcept { release(block, 0); }
+void operator delete[](void *block, const nothrow_t &) noexcept { release(block, 0); }
+void operator delete(void *block, align_val_t alignment, const nothrow_t &) noexcept { release(block, size_t(alignment)); }
+void operator delete[](void *block, align_val_t alignment, const nothrow_t &) noexcept { release(block, size_t(alignment)); }
+
+static void Index(benchmark::State &state)
+{
+    const size_t links  = state.range(0);
+    const size_t unique = links / 20;
+    Usage usage;
+
+    for (auto _: state) {
+        mt19937 random(3);
+        const Measure measure;
+        URLIndex index;
+        for (size_t l = 0; l < links; l++) {
+            const size_t u = random() % unique;
+            string URL = "https://www.site" + to_string(u % 500) + ".example.com/docs/page" + to_string(u) + ".html?ref=list";
+            if (l % 4 == 0) URL.replace(0, 5, "HTTPS");
+            index.add({l / 1000, long(l % 1000) + 1, int(l % 80) + 1, move(URL)});
+        }
+        usage = measure.take();
+        benchmark::DoNotOptimize(index.uniqueURLs());
+    }
+    report(state, usage, links);
+}
+BENCHMARK(Index)->Arg(1 << 17)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+
+static void Extract(benchmark::State &state)
+{
+    const size_t links = state.range(0);
+    const fs::path file = fs::temp_directory_path() / ("fud_memory_" + to_string(links) + ".md");
+    {
+        ofstream out(file);
+        for (size_t l = 0; l < links; l++) {
+            const size_t u = l * 7919 % (links / 20);
+            out << "See https://www.site" << u % 500 << ".example.com/docs/page" << u << ".html?ref=list\n";
+        }
+    }
+    Usage usage;
+    size_t found = 0;
+
+    for (auto _: state) {
+        const Measure measure;
+        Checker checker({file.string()}, ScanOptions());
+        const ExtractedLinks extracted = checker.extractURLS();
+        usage = measure.take();
+        found = extracted.occurrences.size();
+    }
+    fs::remove(file);
+    report(state, usage, found);
+}
+BENCHMARK(Extract)->Arg(1 << 17)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
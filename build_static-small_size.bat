@@ -5,8 +5,10 @@
 ::--disable-dependency-tracking --enable-ipv6 --disable-ftp --disable-file \
 ::--disable-ldap --disable-ldaps --disable-rtsp --disable-proxy --disable-dict \
 ::--disable-telnet --disable-tftp --disable-pop3 --disable-imap --disable-smtp \
-::--disable-gopher --disable-sspi --disable-manual --disable-zlib --without-zlib
+::--disable-gopher --disable-sspi --disable-manual
 ::This will produce a very small static CURL library for your future projects.
+::FUD reads .gz, .tar.gz and .zip archives with zlib, so "-lz" is linked too: a static
+::zlib (libz.a) has to be in one of the "-L" paths, curl can then be built with it as well.
 ::
 :: <3 Xen <xen-dev@pm.me> 2022 xen-e.github.io
 ::
@@ -16,5 +18,5 @@ ECHO.
 ECHO Checking if bin folder exists or creating one...
 if not exist "bin" mkdir "bin" ::Making sure "bin" folder exists before building
 ECHO OK, building...
-g++ -s -Os -ffunction-sections -fdata-sections -Wl,--gc-sections -DNDEBUG -DCURL_STATICLIB src/*.cpp -o bin/fud-small-static -Iinclude -LC:\\Libraries\\curl-7.75.0\\gcc-64-static\\lib -lcurl -lnghttp2 -lidn2 -lpsl -lssl -lcrypto -lcrypto -lgdi32 -lzstd -lbrotlidec -lws2_32
+g++ -s -Os -ffunction-sections -fdata-sections -Wl,--gc-sections -DNDEBUG -DCURL_STATICLIB src/*.cpp -o bin/fud-small-static -Iinclude -LC:\\Libraries\\curl-7.75.0\\gcc-64-static\\lib -lcurl -lz -lnghttp2 -lidn2 -lpsl -lssl -lcrypto -lcrypto -lgdi32 -lzstd -lbrotlidec -lws2_32
 ECHO Done.
\ No newline at end of file
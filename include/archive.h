@@ -0,0 +1,59 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+using namespace std;
+
+/*
+Reads the members of an archive straight from memory, nothing is extracted to disk. Gzip
+is inflated as a stream and a tar inside it is split on the fly, only one member is held at
+a time. Zip members are found through the central directory, stored or deflated.
+Supported: .gz, .tar, .tar.gz/.tgz and .zip, recognized by their name and first bytes.
+Documents built on zip (.docx, .odt, .epub, .jar...) aren't archives here.
+*/
+class ArchiveReader
+{
+public:
+    enum Format { None, Gzip, Tar, Zip, Unsupported };
+
+    //From the name and the first bytes, None for anything not named like an archive
+    static Format detect(const char *data, size_t size, const string &path, string &what);
+
+    //"size" is the member's real size, content is empty when it's over "maxMember" (0 = no limit)
+    using MemberCallback = function<void(const string &name, string &&content, uint64_t size)>;
+
+    //False when the archive is damaged or uses something unsupported, "problem" says what.
+    //Members found before the problem were already given to the callback.
+    static bool read(Format format, const char *data, size_t size, const string &path,
+                     uint64_t maxMember, const MemberCallback &member, string &problem);
+
+private:
+    class Stream;
+    class MemoryStream;
+    class GzipStream;
+
+    static bool readTar(Stream &stream, const char *first, uint64_t maxMember,
+                        const MemberCallback &member, string &problem);
+    static bool readZip(const char *data, size_t size, uint64_t maxMember,
+                        const MemberCallback &member, string &problem);
+};
+
+#endif // ARCHIVE_H
@@ -0,0 +1,41 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#ifndef BINARYIO_H
+#define BINARYIO_H
+
+#include <cstring>
+#include <string>
+
+using namespace std;
+
+//Internal to libfud: fixed size fields of the manifest and cache records, in the machine's byte order
+namespace binaryio {
+
+template <typename T>
+void put(string &out, T value) { out.append(reinterpret_cast<const char*>(&value), sizeof(T)); }
+
+template <typename T>
+T get(const char *&in)
+{
+    T value;
+    memcpy(&value, in, sizeof(T));
+    in += sizeof(T);
+    return value;
+}
+
+} //namespace binaryio
+
+#endif // BINARYIO_H
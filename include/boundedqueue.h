@@ -0,0 +1,103 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+using namespace std;
+
+/*
+Hand-off point between two threads with a fixed capacity: the producer blocks once the
+queue is full, so it can never run too far ahead of the consumer and memory stays flat.
+The producer calls close() when it's done, the consumer knows it has seen everything
+when pop() returns false.
+*/
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity ? capacity : 1) {}
+
+    void push(T item)
+    {
+        unique_lock<mutex> guard(lock);
+        notFull.wait(guard, [this] { return items.size() < capacity; });
+        items.push_back(move(item));
+        notEmpty.notify_one();
+        if (notifier) notifier();
+    }
+
+    //Waits for an item, false means the queue is closed and empty
+    bool pop(T &item)
+    {
+        unique_lock<mutex> guard(lock);
+        notEmpty.wait(guard, [this] { return !items.empty() || closed; });
+        return take(item);
+    }
+
+    //Never waits, false means there's nothing right now
+    bool tryPop(T &item)
+    {
+        lock_guard<mutex> guard(lock);
+        return take(item);
+    }
+
+    void close()
+    {
+        lock_guard<mutex> guard(lock);
+        closed = true;
+        notEmpty.notify_all();
+        if (notifier) notifier();
+    }
+
+    bool isDrained()
+    {
+        lock_guard<mutex> guard(lock);
+        return closed && items.empty();
+    }
+
+    //Called (with the queue locked) every time an item arrives or the queue is closed,
+    //useful to wake up a consumer that waits on something else, like sockets.
+    void setNotifier(function<void()> callback)
+    {
+        lock_guard<mutex> guard(lock);
+        notifier = move(callback);
+    }
+
+private:
+    bool take(T &item)
+    {
+        if (items.empty()) return false;
+        item = move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    const size_t capacity;
+    deque<T> items;
+    bool closed = false;
+    function<void()> notifier;
+
+    mutex lock;
+    condition_variable notEmpty, notFull;
+};
+
+#endif // BOUNDEDQUEUE_H
@@ -17,74 +17,50 @@
 #define CHECKER_H
 
 #include <iostream>
+#include <cstdint>
 #include <vector>
 #include <string>
-#include <fstream>
-#include <regex>
+#include <algorithm>
 #include <chrono>
+#include <memory>
 
 #include <curl/curl.h>
 #include <colors.h>
+#include <scanner.h>
+#include <prefilter.h>
+#include <filereader.h>
+#include <threadpool.h>
+#include <boundedqueue.h>
+#include <urlindex.h>
+#include <resultcache.h>
+#include <manifest.h>
+#include <sniffer.h>
+#include <archive.h>
+#include <pathtable.h>
+#include <reportwriter.h>
+#include <scanoptions.h>
+#include <markup.h>
 
 using namespace std;
 using namespace chrono;
 
-extern int    timeout;
-extern bool   ipv6;
-extern bool   followRedirects;
-extern long   maxRedirects;
-extern bool   useProxy;
-extern string proxy;
-extern bool   duplicateCheck;
-extern bool   verbose;
-
-
-extern bool CURL_REDIRECT_PROTOCOL_ALL;
-extern bool CURL_REDIRECT_PROTOCOL_DICT;
-extern bool CURL_REDIRECT_PROTOCOL_FILE;
-extern bool CURL_REDIRECT_PROTOCOL_FTP;
-extern bool CURL_REDIRECT_PROTOCOL_FTPS;
-extern bool CURL_REDIRECT_PROTOCOL_GOPHER;
-extern bool CURL_REDIRECT_PROTOCOL_HTTP;
-extern bool CURL_REDIRECT_PROTOCOL_HTTPS;
-extern bool CURL_REDIRECT_PROTOCOL_IMAP;
-extern bool CURL_REDIRECT_PROTOCOL_IMAPS;
-extern bool CURL_REDIRECT_PROTOCOL_LDAP;
-extern bool CURL_REDIRECT_PROTOCOL_LDAPS;
-extern bool CURL_REDIRECT_PROTOCOL_POP3;
-extern bool CURL_REDIRECT_PROTOCOL_POP3S;
-extern bool CURL_REDIRECT_PROTOCOL_RTMP;
-extern bool CURL_REDIRECT_PROTOCOL_RTMPE;
-extern bool CURL_REDIRECT_PROTOCOL_RTMPS;
-extern bool CURL_REDIRECT_PROTOCOL_RTMPT;
-extern bool CURL_REDIRECT_PROTOCOL_RTMPTE;
-extern bool CURL_REDIRECT_PROTOCOL_RTMPTS;
-extern bool CURL_REDIRECT_PROTOCOL_RTSP;
-extern bool CURL_REDIRECT_PROTOCOL_SCP;
-extern bool CURL_REDIRECT_PROTOCOL_SFTP;
-extern bool CURL_REDIRECT_PROTOCOL_SMB;
-extern bool CURL_REDIRECT_PROTOCOL_SMBS;
-extern bool CURL_REDIRECT_PROTOCOL_SMTP;
-extern bool CURL_REDIRECT_PROTOCOL_SMTPS;
-extern bool CURL_REDIRECT_PROTOCOL_TELNET;
-extern bool CURL_REDIRECT_PROTOCOL_TFTP;
-
-
-
 class timer
 {
 using clock           = steady_clock;
 using time_point_type = time_point<clock, milliseconds>;
 
 public:
-    timer () { start = time_point_cast<milliseconds>(clock::now()); }
+    timer () { restart(); }
 
-    long getTimeElapsed() {
+    void restart() { start = time_point_cast<milliseconds>(clock::now()); }
+
+    long getTimeElapsed() const {
         auto end = clock::now();
         return duration_cast<milliseconds>(end - start).count();
     }
-    string getTimeElapsedStr() {
-        const long t(getTimeElapsed());
+    string getTimeElapsedStr() const { return humanReadable(getTimeElapsed()); }
+
+    static string humanReadable(long t) {
         if (t < 1000) return to_string(t) + " milliseconds";
         else if (t >= 1000 && t < 60000) return to_string(t/1000) + " second(s)";
         else return to_string(t/60000) + " minute(s)";
@@ -94,33 +70,50 @@ private:
     time_point_type start;
 };
 
-struct DiagnosedFile
+//Every link of the files, a URL written several times is stored once
+struct ExtractedLinks
 {
-    string path, name;
-    vector<long> lineNums;
-    vector<int> positions;
-    vector<string> allLinks;
+    vector<string>     files;       //Occurrence::file is an index in here
+    StringPool         URLs;        //Occurrence::URL is an id in here
+    vector<Occurrence> occurrences; //In the order of the files
 };
+
+using LinkQueue = BoundedQueue<FoundLink>;
+
 class Checker
 {
 private:
-    inline static vector<string> files;
+    const ScanOptions   options;
+    const ScanCallbacks callbacks;
+    const bool          verbose; //Only shown on the console
+    CURLSH             *share;   //Warm connections of previous scans, nullptr = a share of its own
+    ResultCache        *results; //Kept by the caller between scans, nullptr = options.cachePath
 
-    static size_t writeCallback(const char *in, size_t size, size_t num, string *out)
-    {
-        const size_t totalBytes(size * num);
-        out->append(in, totalBytes);
-        return totalBytes;
-    }
-    static const string baseName(const string &filePath)
-    {
-        return filePath.substr(filePath.find_last_of("/\\") + 1);
-    }
+    vector<string> files;
+    PathTable      paths; //Files (and archive members) links were found in
+
+    //"fileOpened" gets the index in "paths" of each file about to give its links
+    void scanFiles(const function<void(size_t)> &fileOpened,
+                   const function<void(FoundLink&&)> &linkFound);
 
 public:
-    Checker(const vector<string> &files) { this->files = files; }
-    const vector<DiagnosedFile> extractURLS();
-    static void checkURLs(const vector<DiagnosedFile> &diagnosedFiles);
+    Checker(const vector<string> &files, const ScanOptions &options,
+            const ScanCallbacks &callbacks = ScanCallbacks(), CURLSH *share = nullptr,
+            ResultCache *results = nullptr);
+
+    //Reads all files and returns their URLs
+    ExtractedLinks extractURLS();
+    //Streaming version, URLs are pushed as soon as they're found then the queue is closed
+    void extractURLS(LinkQueue &queue);
+    //Checks URLs until the queue is closed and drained, every unique URL is requested
+    //once and reported at all its locations. Counts what it did in "summary".
+    void checkURLs(LinkQueue &queue, ScanSummary &summary);
+
+    //Extraction and checking running at the same time, connected by a bounded queue
+    ScanSummary run();
 };
 
+//Shown on the console when there's one, and given to the "problem" callback
+void reportProblem(const ScanOptions &options, const ScanCallbacks &callbacks, const string &message, Color color);
+
 #endif // CHECKER_H
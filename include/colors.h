@@ -34,9 +34,8 @@ enum Color {
     error       = 0x0006
 };
 
-extern bool ANSI; //Global
-
-static void dye(const string &msg, Color color)
+//"ansi": escape sequences, or the console API on Windows
+inline void dye(const string &msg, Color color, bool ansi)
 {
     /*
     for(int k=1; k<=255;k++) {
@@ -44,7 +43,7 @@ static void dye(const string &msg, Color color)
         cout << k << " -> hahahahahahahahahaaha" << endl;
     }*/
 
-    if (ANSI) {
+    if (ansi) {
         switch (color) {
         case bold: cout << "\e[1m" << msg << "\e[0m"; break;
         case dim: cout << "\e[2m" << msg << "\e[0m"; break;
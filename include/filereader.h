@@ -0,0 +1,72 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#ifndef FILEREADER_H
+#define FILEREADER_H
+
+#include <cstddef>
+#include <string>
+
+using namespace std;
+
+/*
+Read-only view of a whole file. POSIX systems map it in memory so URLs are scanned
+in place without copying a single line, everywhere else (or if mapping fails) the file
+is read into one aligned buffer using large blocks.
+*/
+class MappedFile
+{
+public:
+    explicit MappedFile(const string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile &operator=(const MappedFile&) = delete;
+
+    bool        isOpen() const   { return opened; }
+    bool        isMapped() const { return mapped; }
+    const char *data() const     { return bytes; }
+    size_t      size() const     { return length; }
+
+private:
+    bool readBlocks(const string &path);
+
+    const char *bytes  = nullptr;
+    size_t      length = 0;
+    bool        opened = false;
+    bool        mapped = false;
+    char       *buffer = nullptr; //Only used when the file is not mapped
+};
+
+//Turns byte offsets into line numbers and columns. Newlines are only counted up to the
+//offsets asked for, and offsets must be increasing, so the text is walked once at most.
+class LineCounter
+{
+public:
+    explicit LineCounter(const char *text) : text(text) {}
+
+    void advance(size_t offset);
+
+    long line() const             { return lineNum; }
+    int  column(size_t offset) const { return offset - lineStart + 1; }
+
+private:
+    const char *text;
+    size_t counted   = 0;
+    size_t lineStart = 0;
+    long   lineNum   = 1;
+};
+
+#endif // FILEREADER_H
@@ -0,0 +1,80 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#ifndef FUD_H
+#define FUD_H
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <curl/curl.h>
+#include <scanoptions.h>
+#include <resultcache.h>
+
+using namespace std;
+
+/*
+Libcurl shares (DNS answers, TLS sessions and connections) kept between scans, so the next
+scan starts with warm connections. libcurl can't share connections between threads running
+at the same time, so each running scan takes a share of its own and gives it back at the end.
+*/
+class SharePool
+{
+public:
+    SharePool() = default;
+    ~SharePool();
+
+    SharePool(const SharePool&) = delete;
+    SharePool &operator=(const SharePool&) = delete;
+
+    //A share left by a previous scan, or a new one (nullptr if it couldn't be made)
+    CURLSH *acquire();
+    void release(CURLSH *share);
+
+    //A share for one thread, no locking
+    static CURLSH *create();
+
+private:
+    mutex lock;
+    vector<CURLSH*> spare;
+};
+
+/*
+FUD as a library: reads files and checks the URLs found in them. A Scanner has no other
+state than its options and the connections its scans left, it can run several scans at the
+same time from different threads. Results come through the callbacks and the summary.
+*/
+class Scanner
+{
+public:
+    explicit Scanner(const ScanOptions &options = ScanOptions());
+
+    Scanner(const Scanner&) = delete;
+    Scanner &operator=(const Scanner&) = delete;
+
+    //Directories aren't walked, "files" are the files to read
+    ScanSummary scan(const vector<string> &files, const ScanCallbacks &callbacks = ScanCallbacks());
+    //With other options than the scanner's, the connections are still shared. "results"
+    //(one scan at a time) are used instead of opening options.cachePath when given.
+    ScanSummary scan(const vector<string> &files, const ScanOptions &options,
+                     const ScanCallbacks &callbacks, ResultCache *results = nullptr);
+
+private:
+    const ScanOptions options;
+    SharePool shares;
+};
+
+#endif // FUD_H
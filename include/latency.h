@@ -0,0 +1,68 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+//The last "capacity" samples of something, in milliseconds
+class LatencyWindow
+{
+public:
+    explicit LatencyWindow(size_t capacity = 64) : capacity(capacity) {}
+
+    void add(long ms);
+
+    size_t size() const { return samples.size(); }
+    //"p" between 0 and 100, nearest rank. 0 when there's no sample
+    long percentile(double p) const;
+
+private:
+    vector<long> samples;
+    size_t capacity;
+    size_t next = 0; //Oldest sample, overwritten once the window is full
+};
+
+/*
+Per host request deadlines derived from how the host behaved so far in the run. Once a host
+answered a few times its deadline is a multiple of its 95th percentile, so a host that's
+slow but healthy keeps the headroom it needs and one that stalls is cut off long before
+the global timeout. Hosts without enough answers get the global timeout.
+*/
+class AdaptiveDeadlines
+{
+public:
+    AdaptiveDeadlines(long ceilingMs, long floorMs) : ceiling(ceilingMs), floor(min(floorMs, ceilingMs)) {}
+
+    //Only requests that got an answer
+    void record(const string &host, long ms) { hosts[host].add(ms); }
+
+    long deadline(const string &host) const;
+
+private:
+    static const size_t minSamples = 5;
+    static const long   factor     = 4;
+
+    unordered_map<string, LatencyWindow> hosts;
+    long ceiling, floor;
+};
+
+#endif // LATENCY_H
@@ -0,0 +1,147 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#ifndef LINKCHECKER_H
+#define LINKCHECKER_H
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <curl/curl.h>
+#include <checker.h>
+#include <scheduler.h>
+#include <resolver.h>
+#include <latency.h>
+#include <metrics.h>
+#include <fud.h>
+
+using namespace std;
+
+//One in-flight request of the checker, the entry knows every place the URL was found
+//so results can be reported against the right files, lines and positions.
+struct Transfer
+{
+    enum Method { Head, RangedGet };
+
+    CURL            *handle = nullptr;
+    URLIndex::Entry *entry  = nullptr;
+    Method           method = Head;
+    bool             bodyAborted = false; //The status was known, the body was cut off
+    long             retryAfter  = -1;    //Seconds, from a "Retry-After" header
+    curl_slist      *resolve     = nullptr; //Addresses found by the resolver, for CURLOPT_RESOLVE
+    long             deadline    = 0;       //Milliseconds, 0 = the global timeout
+    char             errorBuffer[CURL_ERROR_SIZE] = {};
+    timer            elapsed;
+
+    //Validators sent by the server, and the ones we send back for a stale cached result
+    string              etag, lastModified;
+    const CachedResult *revalidating = nullptr;
+    curl_slist         *conditions   = nullptr;
+};
+
+/*
+The network side of FUD: one curl multi handle, a fixed pool of easy handles and a
+scheduler that hands them URLs host by host. Hosts are resolved ahead of their requests,
+connections, TLS sessions and DNS answers are shared between all handles, and with
+the previous scans when a share is given.
+*/
+class LinkChecker
+{
+public:
+    LinkChecker(const PathTable &files, const ScanOptions &options,
+                const ScanCallbacks &callbacks, CURLSH *share = nullptr,
+                ResultCache *results = nullptr);
+    ~LinkChecker();
+
+    LinkChecker(const LinkChecker&) = delete;
+    LinkChecker &operator=(const LinkChecker&) = delete;
+
+    //Checks URLs until the queue is closed and drained, every unique URL is requested
+    //once and reported at all its locations. Counts what it did in "summary".
+    void run(LinkQueue &queue, ScanSummary &summary);
+
+private:
+    bool init();
+    void accept(FoundLink &&link);
+    void schedule(URLIndex::Entry *entry);
+    void resolved(vector<HostResolver::Answer> &answers);
+    void unresolved(URLIndex::Entry &entry);
+    void skipUnreachable();
+    void startWaiting();
+    void finish(Transfer *transfer, CURLcode res_code);
+    void complete(URLIndex::Entry &entry);
+
+    void setupHandle(Transfer *transfer);
+    void startTransfer(Transfer *transfer, Transfer::Method method);
+    void setConditions(Transfer *transfer, const CachedResult *cached);
+    static bool headRejected(CURLcode res_code, long http_code);
+
+    void reportCheck(const URLIndex::Entry &entry);
+    void reportOccurrence(const URLIndex::Entry &entry, const Occurrence &link);
+    void writeRecord(const URLIndex::Entry &entry, const Occurrence &link);
+    static string failure(const CheckResult &result);
+    static RequestSample measure(Transfer *transfer, CURLcode res_code, long http_code, CheckResult::Timings &timings);
+
+    //Bodies are never needed, the status is already known when the first byte arrives
+    //so the transfer is stopped right there (libcurl reports it as a write error).
+    static size_t writeCallback(const char *, size_t size, size_t num, Transfer *transfer)
+    {
+        if (size * num == 0) return 0;
+        transfer->bodyAborted = true;
+        return 0;
+    }
+    static size_t headerCallback(const char *in, size_t size, size_t num, Transfer *transfer);
+
+    const ScanOptions   &options;
+    const ScanCallbacks &callbacks;
+    const bool           verbose; //Only shown on the console
+    const PathTable     &files;
+
+    CURLM  *multi = nullptr;
+    CURLSH *share = nullptr;
+    bool    ownShare;
+    vector<Transfer>  transfers;
+    vector<Transfer*> idle;
+    size_t active    = 0;
+    size_t checked   = 0;
+    size_t links     = 0;
+    size_t deadLinks = 0;
+
+    //A host is looked up once, its URLs wait here until the answer comes
+    struct HostLookup
+    {
+        bool   done = false;
+        HostResolver::Answer::Status status = HostResolver::Answer::Failed;
+        string addresses; //Comma separated, as CURLOPT_RESOLVE wants them
+        vector<URLIndex::Entry*> parked;
+    };
+
+    URLIndex                 index;
+    HostScheduler            scheduler;
+    ResultCache             *cache = nullptr; //Given by the caller, or "ownCache"
+    unique_ptr<ResultCache>  ownCache;
+    unique_ptr<HostResolver> resolver;
+    unique_ptr<AdaptiveDeadlines> deadlines;
+    unique_ptr<ReportWriter> report; //--format, records of every occurrence
+    NetworkMetrics metrics;          //Timings of every request, --timings and --metrics
+    unordered_map<string, HostLookup> lookups;
+    size_t parked = 0;
+    LocalLinks localLinks; //file:// URLs of relative links, with the anchors of their targets
+};
+
+#endif // LINKCHECKER_H
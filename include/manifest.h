@@ -0,0 +1,75 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+/*
+What the previous run found in each file, for --incremental. A file with the same size and
+modification time is not opened at all, one with the same size and content hash is read
+but not scanned again, the stored URLs are used instead. The manifest is rewritten at the
+end of the run with the files of that run only.
+*/
+class FileManifest
+{
+public:
+    struct Occurrence
+    {
+        long   lineNum  = 0;
+        int    position = 0;
+        string URL;
+    };
+
+    struct Record
+    {
+        uint64_t size  = 0;
+        int64_t  mtime = 0; //Whatever unit the filesystem clock uses, only compared
+        uint64_t hash  = 0;
+        vector<Occurrence> occurrences;
+    };
+
+    explicit FileManifest(const string &path);
+
+    FileManifest(const FileManifest&) = delete;
+    FileManifest &operator=(const FileManifest&) = delete;
+
+    //False when the file exists but isn't a manifest, it's never overwritten then
+    bool isUsable() const { return !foreign; }
+    size_t size() const { return previous.size(); }
+
+    //What the previous run recorded, safe to call from several threads
+    const Record *find(const string &file) const;
+    //Records of this run, saved by save()
+    void update(const string &file, Record &&record) { current[file] = move(record); }
+    bool save();
+
+    static uint64_t hash(const char *data, size_t size);
+
+private:
+    void load();
+
+    unordered_map<string, Record> previous, current;
+    string path;
+    bool   foreign = false;
+};
+
+#endif // MANIFEST_H
@@ -0,0 +1,78 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#ifndef MARKUP_H
+#define MARKUP_H
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+/*
+Streaming tokenizer of HTML and Markdown: targets of href and src attributes, Markdown links,
+images and reference definitions, and the anchors links can point to (ids, names of <a> and
+Markdown headings the way GitHub turns them into ids). Text, comments, scripts, styles and
+code blocks are skipped, absolute URLs are still found by URLScanner.
+*/
+class MarkupScanner
+{
+public:
+    enum Kind { None, HTML, Markdown };
+
+    struct Link
+    {
+        size_t offset = 0; //Of the target in the text
+        string target;     //As written, entities decoded
+    };
+
+    //.html, .htm, .xhtml, .md and .markdown in any case
+    static Kind kindOf(const string &path);
+
+    //Targets in the order of the text, "base" gets the <base href> if there's one
+    static void links(const char *text, size_t size, Kind kind, vector<Link> &links, string &base);
+    static void anchors(const char *text, size_t size, Kind kind, unordered_set<string> &anchors);
+
+    //What a target of "file" points to: a file:// URL (fragment kept), an absolute URL when
+    //<base> is one, or nothing when the target is absolute or can't be resolved offline
+    static string resolve(const string &file, const string &base, const string &target);
+};
+
+/*
+Offline checks of the file:// URLs relative links are resolved to: the file or directory must
+exist and a fragment must be an anchor of the target when it's HTML or Markdown. Anchors of a
+target are indexed once, when the first link with a fragment points to it.
+*/
+class LocalLinks
+{
+public:
+    //Empty if the link is good, why it isn't otherwise
+    string check(const string &URL);
+
+private:
+    struct Target
+    {
+        bool looked  = false; //Up on the file system
+        bool exists  = false;
+        bool indexed = false; //Anchors read
+        MarkupScanner::Kind   kind = MarkupScanner::None;
+        unordered_set<string> anchors;
+    };
+    unordered_map<string, Target> targets; //By path
+};
+
+#endif // MARKUP_H
@@ -0,0 +1,96 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+using namespace std;
+
+//Time spent in each phase of one request, in microseconds (not cumulative like libcurl's)
+struct RequestSample
+{
+    long     dns = 0, connect = 0, tls = 0, wait = 0, total = 0; //wait: from the request sent to the first byte
+    long     httpCode  = 0;
+    bool     failed    = false; //No answer at all (connect, timeout, TLS... errors)
+    long     redirects = 0;
+    uint64_t received  = 0;     //Headers and body, redirects included
+    uint64_t sent      = 0;
+};
+
+//Fixed buckets, the same as the Prometheus histograms written from it
+class Histogram
+{
+public:
+    //Upper bounds in microseconds, from 0.1 millisecond to 1 minute, the last bucket is +Inf
+    static constexpr array<long, 18> bounds = { 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000,
+                                                500000, 1000000, 2500000, 5000000, 10000000, 30000000, 60000000 };
+
+    void add(long us);
+
+    uint64_t count() const { return total; }
+    double   sum() const   { return sumUs; }
+    long     max() const   { return maxUs; }
+    uint64_t bucket(size_t b) const { return counts[b]; } //b == bounds.size() is +Inf
+    //Estimated from the buckets, linear inside the one the quantile falls in. "q" from 0 to 1
+    long quantile(double q) const;
+
+private:
+    array<uint64_t, bounds.size() + 1> counts = {};
+    uint64_t total = 0;
+    double   sumUs = 0;
+    long     maxUs = 0;
+};
+
+struct RequestMetrics
+{
+    enum Phase { DNS, Connect, TLS, Wait, Total, phases };
+    static const char *const phaseNames[phases];
+
+    array<Histogram, phases> histograms;
+    uint64_t requests = 0, failed = 0, redirects = 0, received = 0, sent = 0;
+    array<uint64_t, 6> classes = {}; //No HTTP status, 1xx to 5xx
+
+    void add(const RequestSample &sample);
+};
+
+/*
+Timings of every request of the run, for all hosts and for each host (host:port, like the
+scheduler). Everything happens on the checker thread, nothing is locked. Shown as a table
+at the end of the run and exported as a Prometheus textfile or JSON.
+*/
+class NetworkMetrics
+{
+public:
+    void record(const string &host, const RequestSample &sample);
+
+    bool empty() const { return all.requests == 0; }
+    void printSummary(size_t maxHosts) const;
+    //".json" files get JSON, anything else the Prometheus text format
+    bool write(const string &path) const;
+
+private:
+    string prometheus() const;
+    string json() const;
+
+    RequestMetrics all;
+    unordered_map<string, RequestMetrics> hosts;
+};
+
+#endif // METRICS_H
@@ -0,0 +1,64 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#ifndef PATHTABLE_H
+#define PATHTABLE_H
+
+#include <deque>
+#include <mutex>
+#include <string>
+
+using namespace std;
+
+/*
+Every file links were found in, FoundLink::fileIndex points here. Members of archives are
+only known once the archive is read, so the table grows while the checker is already
+reading it from another thread.
+*/
+class PathTable
+{
+public:
+    size_t add(string path)
+    {
+        lock_guard<mutex> guard(lock);
+        paths.push_back(move(path));
+        return paths.size() - 1;
+    }
+
+    //The deque never moves its strings when it grows, a path stays put until clear()
+    const string &at(size_t index) const
+    {
+        lock_guard<mutex> guard(lock);
+        return paths.at(index);
+    }
+
+    size_t size() const
+    {
+        lock_guard<mutex> guard(lock);
+        return paths.size();
+    }
+
+    void clear()
+    {
+        lock_guard<mutex> guard(lock);
+        paths.clear();
+    }
+
+private:
+    mutable mutex lock;
+    deque<string> paths;
+};
+
+#endif // PATHTABLE_H
@@ -0,0 +1,40 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#ifndef PREFILTER_H
+#define PREFILTER_H
+
+#include <cstddef>
+
+using namespace std;
+
+/*
+Cheap first pass over raw text that looks for the only places where a URL can start:
+":/" (the end of "http://", "https://" and "ftp://") and "www." in any case.
+Most lines have neither, so URLScanner only runs its full matcher next to these hits.
+SSE2 and AVX2 versions are used when the CPU supports them, the choice is made once at runtime.
+*/
+class AnchorFilter
+{
+public:
+    //Offset of the first ':' of a ":/" or the first 'w' of a "www."
+    //at or after "from", returns "size" if there's no candidate.
+    static size_t next(const char *text, size_t size, size_t from);
+
+    //Name of the implementation picked for this CPU (AVX2, SSE2 or scalar)
+    static const char *implementation();
+};
+
+#endif // PREFILTER_H
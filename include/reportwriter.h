@@ -0,0 +1,96 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#ifndef REPORTWRITER_H
+#define REPORTWRITER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+//One occurrence of a checked URL, as it's written in machine-readable reports
+struct ReportRecord
+{
+    string file;
+    long   line   = 0;
+    int    column = 0;
+    string URL;
+    string finalURL;   //After redirects
+    string status;     //"good", "dead" or "unreachable" (host given up, not requested)
+    long   httpCode = 0;
+    int    curlCode = 0;
+    string error;      //Why the request failed, empty when it didn't
+    string origin;     //"network", "cache", "revalidated", "skipped" or "local"
+    long   elapsed = 0; //Milliseconds, retries and fallbacks included
+    //Microseconds since the start of the last request, 0 when there was none
+    long   dns = 0, connect = 0, tls = 0, firstByte = 0, total = 0;
+    long   redirects = 0;
+    uint64_t received = 0; //Bytes, headers included
+};
+
+/*
+Writes report records on its own thread, so a slow disk or a console that can't keep up
+never holds the requests. Records are handed over in batches: write() only moves the record
+into the pending list, the writer formats everything that arrived meanwhile and flushes it
+in one go, so the report is streamed while the run is still going.
+SARIF is a single JSON document, its header is written right away and its end on close(),
+only problems are listed there.
+*/
+class ReportWriter
+{
+public:
+    enum Format { JsonLines, CSV, SARIF };
+
+    //"-" or an empty path writes to the standard output
+    ReportWriter(Format format, const string &path);
+    ~ReportWriter();
+
+    ReportWriter(const ReportWriter&) = delete;
+    ReportWriter &operator=(const ReportWriter&) = delete;
+
+    bool isOpen() const { return out != nullptr; }
+    void write(ReportRecord &&record);
+    //Writes what's left and the end of the document, false if anything failed to be written
+    bool close();
+
+    static bool parseFormat(const string &name, Format &format);
+    static bool toStandardOutput(const string &path) { return path.empty() || path == "-"; }
+
+private:
+    void loop();
+    void header(string &buffer) const;
+    void footer(string &buffer) const;
+    void format(const ReportRecord &record, string &buffer);
+
+    Format format_;
+    FILE  *out   = nullptr;
+    bool   owned = false; //Not the standard output
+    bool   failed = false;
+    size_t written = 0;   //Records, SARIF needs commas between them
+
+    mutex                lock;
+    condition_variable   wakeup;
+    vector<ReportRecord> pending;
+    bool                 closing = false;
+    thread               writer;
+};
+
+#endif // REPORTWRITER_H
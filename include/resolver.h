@@ -0,0 +1,71 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <threadpool.h>
+
+using namespace std;
+
+/*
+Resolves host names ahead of the requests, many at once on its own threads. Answers are
+picked up by the checker loop with collect(), the notifier tells it when one is ready.
+This way libcurl never waits on DNS inside a transfer, and URLs of a host that doesn't
+exist are known to be dead without a single connection attempt.
+*/
+class HostResolver
+{
+public:
+    struct Answer
+    {
+        enum Status { Resolved, NotFound, Failed };
+
+        string         host;
+        Status         status = Failed;
+        vector<string> addresses; //Numeric, IPv6 ones within [brackets]
+    };
+
+    HostResolver(unsigned threads, bool ipv6);
+
+    void setNotifier(function<void()> notifier) { this->notifier = move(notifier); }
+
+    void resolve(const string &host);
+    //Moves the answers received so far to "answers"
+    void collect(vector<Answer> &answers);
+
+    size_t pending() const { return requested - collected; }
+
+private:
+    static Answer lookup(const string &host, bool ipv6);
+
+    bool             ipv6;
+    function<void()> notifier;
+
+    mutex          answersLock;
+    vector<Answer> ready;
+    size_t requested = 0;
+    size_t collected = 0;
+
+    //Declared last so its threads are joined before anything they use goes away
+    ThreadPool pool;
+};
+
+#endif // RESOLVER_H
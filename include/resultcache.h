@@ -0,0 +1,76 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+
+using namespace std;
+
+//Last known answer of a URL, enough to skip it while fresh or to revalidate it when stale
+struct CachedResult
+{
+    long    httpCode = 0;
+    bool    isHTTP   = true;
+    int64_t checkedAt = 0; //Seconds since epoch
+    string  finalURL;
+    string  etag;
+    string  lastModified;
+};
+
+/*
+Results of previous runs, stored in an append-only log: a small header followed by one
+binary record per check, the last record of a URL wins. Loading is a single pass over the
+mapped file, saving a result is one buffered append, so a million entries cost almost
+nothing at startup. The log is rewritten without the outdated records when they start
+to take more space than the live ones. Without a path results are only kept in memory.
+Only real answers of servers are stored, network errors and transient answers (408, 429
+and 5xx) are always retried.
+*/
+class ResultCache
+{
+public:
+    ResultCache(const string &path, long ttl);
+    ~ResultCache();
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache &operator=(const ResultCache&) = delete;
+
+    bool isOpen() const { return log != nullptr; }
+    size_t size() const { return entries.size(); }
+
+    const CachedResult *find(const string &key) const;
+    bool isFresh(const CachedResult &result) const;
+    void store(const string &key, const CachedResult &result);
+
+    static int64_t now();
+
+private:
+    bool load();
+    bool rewrite();
+    void append(const string &key, const CachedResult &result);
+
+    unordered_map<string, CachedResult> entries;
+    string path;
+    long   ttl;
+    FILE  *log = nullptr;
+    bool   foreign = false; //The file exists but it's not a cache
+};
+
+#endif // RESULTCACHE_H
@@ -0,0 +1,54 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#ifndef SCANNER_H
+#define SCANNER_H
+
+#include <cstddef>
+
+using namespace std;
+
+//Position of a URL inside the scanned text
+struct URLMatch
+{
+    size_t offset = 0; //From the beginning of the text
+    size_t length = 0;
+};
+
+/*
+Hand written replacement of the URL regex that extractURLS() used to build for every line:
+
+(http://|ftp://|https://|www\.)([\w_-]+(?:(?:\.[\w_-]+)+))([\w.,@?^=%&:/~+#-]*[\w@?^=%&/~+#-])?
+
+The grammar and the matched text are exactly the same (case insensitive prefixes, greedy
+host, trailing '.', ',' and ':' are not part of the URL), but nothing is compiled or
+allocated and every URL of the text can be found by calling find() again from the end
+of the previous match. AnchorFilter is used to jump straight to the places where a prefix
+can be, so text without URLs is skipped at vector speed.
+*/
+class URLScanner
+{
+public:
+    //Looks for the first URL in text[from, size), returns false if there's none
+    static bool find(const char *text, size_t size, size_t from, URLMatch &match);
+
+    //Returns the length of the URL starting exactly at "p" or 0 if there's no URL there
+    static size_t matchAt(const char *p, const char *end);
+
+private:
+    static size_t prefixLength(const char *p, const char *end);
+};
+
+#endif // SCANNER_H
@@ -0,0 +1,103 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#ifndef SCANOPTIONS_H
+#define SCANOPTIONS_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include <curl/curl.h>
+#include <reportwriter.h>
+
+using namespace std;
+
+//Everything a scan can be told, the defaults are the ones of the command line
+struct ScanOptions
+{
+    //Requests
+    int    timeout          = 30;    //sec
+    int    connectTimeout   = 10;    //sec, 0 = only "timeout" applies
+    long   lowSpeedLimit    = 1;     //bytes per second
+    long   lowSpeedTime     = 0;     //sec below "lowSpeedLimit" before giving up, 0 = disabled
+    bool   adaptiveTimeout  = false; //Per host deadlines derived from the latencies seen so far
+    int    jobs             = 16;    //Maximum simultaneous requests
+    int    perHost          = 4;     //Maximum simultaneous requests to the same host
+    double perHostRate      = 0;     //Maximum requests started per second on the same host, 0 = no limit
+    int    breakerThreshold = 3;     //Connect failures/timeouts in a row before a host is given up, 0 = never
+    bool   breakerProbe     = true;  //One last request before giving up a host?
+    bool   ipv6             = false; //Forces IPv6
+    bool   followRedirects  = true;  //Follow HTTP redirects?
+    long   maxRedirects     = -1;    //-1 = infinite | 0 = no redirects.
+    bool   useProxy         = false; //Use proxy?
+    string proxy;                    //http:// https:// socks4:// socks4a:// socks5:// socks5h://
+    bool   duplicateCheck   = false; //If true then near-duplicate URLs are checked separately
+    bool   headRequests     = true;  //HEAD first or a 1 byte ranged GET right away
+
+    /*
+    Protocols redirects may lead to, CURLPROTO_* flags.
+
+    By default libcurl will allow HTTP, HTTPS, FTP and FTPS on redirect (7.65.2).
+    Older versions of libcurl allowed all protocols on redirect except several disabled
+    for security reasons: Since 7.19.4 FILE and SCP are disabled,
+    and since 7.40.0 SMB and SMBS are also disabled.
+    CURLPROTO_ALL enables all protocols on redirect, including those disabled for security.
+    */
+    long   redirectProtocols = CURLPROTO_ALL;
+
+    //Files
+    int    threads          = 0;     //Threads used to read files, 0 = one per CPU core
+    uintmax_t maxFileSize   = 256 << 20; //Bytes, bigger files aren't scanned, 0 = no limit
+    bool   localLinks       = true;  //Relative links of HTML and Markdown files, checked on the file system
+
+    //What's kept between runs. Scans running at the same time shouldn't share these files.
+    string cachePath;                //Results of previous runs, empty = no cache
+    long   cacheTTL         = 3600;  //sec, cached results younger than this skip the network
+    string manifestPath;             //Files and URLs of the previous run, empty = full scan
+
+    //Output
+    string reportFormat;             //jsonl, csv or sarif, empty = no report
+    string reportPath;               //Where the report goes, empty or "-" = standard output
+    string metricsPath;              //Prometheus textfile or JSON (.json) of the timings, empty = none
+    bool   showTimings      = false; //Table of the request timings at the end
+    bool   console          = true;  //Human readable progress and dead links on the standard output
+    bool   verbose          = false; //More of it, only with "console"
+#ifdef WIN32
+    bool   ansi             = false; //Colors through escape sequences, otherwise through the console API
+#else
+    bool   ansi             = true;
+#endif
+};
+
+//Called on the threads of the scan, a callback shouldn't block it for long
+struct ScanCallbacks
+{
+    //Every place a URL was found at, once the URL is checked
+    function<void(const ReportRecord &record)> link;
+    //What went wrong besides links: unreadable files, a cache or report that can't be written...
+    function<void(const string &message)> problem;
+};
+
+struct ScanSummary
+{
+    size_t files     = 0; //Files and archive members URLs were looked for in
+    size_t URLs      = 0; //Unique URLs checked
+    size_t links     = 0; //Places they were found at
+    size_t deadLinks = 0; //Places of URLs that aren't good
+    long   elapsed   = 0; //Milliseconds
+};
+
+#endif // SCANOPTIONS_H
@@ -0,0 +1,104 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <chrono>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <urlindex.h>
+
+using namespace std;
+
+/*
+Decides which URL gets the next free handle. URLs wait in one queue per host and hosts
+take turns, a host never has more than "perHost" requests in flight nor starts more than
+"rate" requests per second (0 = no limit). So a page with 400 links to the same server
+doesn't hold every handle, and the other hosts keep going while it's throttled.
+
+It's also a circuit breaker: after "threshold" requests in a row that couldn't connect or
+timed out, the host is considered down (0 = never). With "probe" one more request is
+sent once the others are done, if it fails too the host's remaining URLs are given back
+by takeUnreachable() instead of being requested.
+*/
+class HostScheduler
+{
+public:
+    using clock = chrono::steady_clock;
+
+    HostScheduler(int perHost, double rate, int threshold, bool probe);
+
+    void add(URLIndex::Entry *entry);
+    //Puts the URL back in front of its host queue and pauses the host, used for "429 Too Many Requests"
+    void retryLater(URLIndex::Entry *entry, long delayMs);
+    //A URL that can start right now or nullptr, its host slot is taken until finished() is called
+    URLIndex::Entry *next();
+    //"reachable" is false when the request couldn't connect or timed out
+    void finished(const URLIndex::Entry *entry, bool reachable);
+    //Moves URLs of hosts found down to "entries", they must not be requested
+    void takeUnreachable(vector<URLIndex::Entry*> &entries);
+
+    struct Tripped
+    {
+        string host;
+        size_t skipped;
+    };
+    vector<Tripped> trippedHosts() const;
+
+    bool   empty() const   { return waitingCount == 0; }
+    size_t waiting() const { return waitingCount; }
+
+    //Servers on other ports of the same host are independent
+    static string key(const URLIndex::Entry &entry) { return entry.host + ':' + to_string(entry.port); }
+
+    //How long until a waiting URL may start, capped by "limit"
+    long msUntilNext(long limit) const;
+
+private:
+    struct Host
+    {
+        enum Breaker { Closed, Probing, Open };
+
+        deque<URLIndex::Entry*> waiting;
+        int               inFlight  = 0;
+        clock::time_point nextStart;
+        bool              inRotation = false;
+
+        Breaker                breaker  = Closed;
+        int                    failures = 0; //In a row
+        const URLIndex::Entry *probe    = nullptr;
+        size_t                 skipped  = 0;
+    };
+
+    void trip(Host &host);
+
+    bool canStart(const Host &host, clock::time_point now) const;
+    void enqueue(Host &host, URLIndex::Entry *entry, bool front);
+
+    unordered_map<string, Host> hosts;
+    deque<Host*> rotation; //Hosts with waiting URLs, in turn order
+    vector<URLIndex::Entry*> unreachable;
+    size_t waitingCount = 0; //Including the unreachable ones not taken yet
+    int    perHost;
+    clock::duration interval; //Between two starts on the same host
+    int    threshold;
+    bool   probe;
+};
+
+#endif // SCHEDULER_H
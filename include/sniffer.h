@@ -0,0 +1,46 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#ifndef SNIFFER_H
+#define SNIFFER_H
+
+#include <cstddef>
+#include <string>
+
+using namespace std;
+
+/*
+Decides from the first block of a file if it's worth scanning. Binaries (NUL bytes, known
+magic numbers, too many bytes that are neither UTF-8 nor usual control characters) are
+skipped, UTF-16 text is recognized with or without a byte order mark.
+*/
+class ContentSniffer
+{
+public:
+    enum Kind { Text, UTF16LE, UTF16BE, Binary };
+
+    static constexpr size_t blockSize = 8192;
+
+    //"what" names the binary format when it's known
+    static Kind sniff(const char *data, size_t size, string &what);
+
+    //Whole text to UTF-8, invalid surrogates become U+FFFD. A byte order mark is dropped.
+    static string toUTF8(const char *data, size_t size, Kind kind);
+
+private:
+    static const char *magic(const unsigned char *data, size_t size);
+};
+
+#endif // SNIFFER_H
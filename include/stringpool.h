@@ -0,0 +1,60 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+/*
+Interned strings: each distinct string is stored once, NUL terminated, one after another in
+blocks that never move, and is known by a 32 bit id. The table of ids is open addressed, so
+a string costs its characters and a few bytes instead of a heap allocation of its own.
+*/
+class StringPool
+{
+public:
+    StringPool() = default;
+    StringPool(StringPool&&) = default;
+    StringPool &operator=(StringPool&&) = default;
+
+    StringPool(const StringPool&) = delete;
+    StringPool &operator=(const StringPool&) = delete;
+
+    //The id of "text", stored the first time it's seen
+    uint32_t intern(string_view text);
+
+    //Valid as long as the pool, followed by a NUL so data() is a C string too
+    string_view at(uint32_t id) const { return strings[id]; }
+    size_t size() const { return strings.size(); }
+
+private:
+    string_view store(string_view text);
+    void grow();
+
+    vector<unique_ptr<char[]>> blocks;
+    char  *next = nullptr; //Free space of the current block
+    size_t left = 0;
+
+    vector<string_view> strings; //By id
+    vector<uint32_t>    slots;   //Id + 1, 0 = free. Never more than half full
+};
+
+#endif // STRINGPOOL_H
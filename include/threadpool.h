@@ -0,0 +1,74 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/*
+Work-stealing pool: every worker owns a queue and takes its newest task first, idle
+workers steal the oldest task of the others. Tasks submitted from inside a task go to
+the queue of the worker running it, so a file split into chunks is mostly handled by
+the thread that opened it while the rest of the pool is still free to help.
+*/
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool &operator=(const ThreadPool&) = delete;
+
+    void submit(function<void()> task);
+    void wait(); //Blocks until every submitted task is finished
+
+    size_t size() const { return workers.size(); }
+
+    //Worker count to use when the user didn't choose one
+    static unsigned defaultThreads();
+
+private:
+    struct Queue
+    {
+        mutex lock;
+        deque<function<void()>> tasks;
+    };
+
+    void work(size_t index);
+    bool take(size_t index, function<void()> &task);
+
+    vector<unique_ptr<Queue>> queues;
+    vector<thread> workers;
+
+    mutex stateLock;
+    condition_variable taskAdded, allDone;
+    size_t queued     = 0; //Waiting in the queues
+    size_t unfinished = 0; //Queued or running
+    bool   stopping   = false;
+    atomic<size_t> nextQueue{0};
+};
+
+#endif // THREADPOOL_H
@@ -0,0 +1,135 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#ifndef URLINDEX_H
+#define URLINDEX_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+
+#include <curl/curl.h>
+#include <stringpool.h>
+
+using namespace std;
+
+//A URL found by the extraction stage, on its way to the checking stage
+struct FoundLink
+{
+    size_t fileIndex = 0; //In Checker's PathTable
+    long   lineNum   = 0;
+    int    position  = 0;
+    string URL;
+};
+
+//A place a URL was found at, packed in 16 bytes: every one of them is kept until the end of the scan
+struct Occurrence
+{
+    uint32_t file   = 0; //In Checker's PathTable
+    uint32_t URL    = 0; //In the pool of the index, as written there
+    uint32_t line   = 0;
+    uint32_t column = 0;
+};
+
+//What the network said about a URL
+struct CheckResult
+{
+    enum Origin { Network, Cache, Revalidated, Skipped, Local }; //Skipped: its host was found unreachable, Local: a file:// URL
+
+    CURLcode curlCode = CURLE_OK;
+    long     httpCode = 0;
+    bool     isHTTP   = true; //Other protocols have no HTTP status to look at
+    long     elapsed  = 0;    //Milliseconds
+    long     deadline = 0;    //Milliseconds, when the request had less than the global timeout
+    string   details;         //libcurl's own explanation of a timeout, what's wrong with a local link
+    string   finalURL;        //After redirects
+    Origin   origin   = Network;
+
+    //Microseconds since the start of the last request, as libcurl measured them
+    struct Timings { long dns = 0, connect = 0, tls = 0, firstByte = 0, total = 0; } timings;
+    long     redirects = 0;
+    uint64_t received  = 0;   //Bytes, headers included
+
+    bool isGood() const
+    {
+        return curlCode == CURLE_OK && (!isHTTP || (httpCode >= 200 && httpCode < 300));
+    }
+};
+
+struct URLParts
+{
+    string scheme;   //Lower case, "http" when the URL starts with "www."
+    string userInfo; //Without the '@'
+    string host;     //Lower case
+    long   port = 0; //0 when none is written in the URL
+    string path;     //From the first '/', without query and fragment
+    string query;    //From the '?', without the fragment
+    string fragment; //From the '#'
+
+    static URLParts parse(const string &URL);
+    static long defaultPort(const string &scheme);
+};
+
+/*
+Every unique URL of the scan with all the places it was found in. URLs are keyed by their
+normalized form: case insensitive scheme and host, default ports, trailing slashes and
+fragments don't matter, so "HTTP://Example.com:80/docs/#top" and "http://example.com/docs"
+are requested once and the result is reported at every location of both. Fragments of
+file:// URLs are kept, anchors of local files are checked too.
+Each spelling of a URL is stored once in a pool and its occurrences only refer to it.
+*/
+class URLIndex
+{
+public:
+    enum class State { Waiting, Checking, Done };
+
+    struct Entry
+    {
+        string_view        URL; //As written the first time, this is what gets requested (NUL terminated)
+        string_view        key; //Normalized URL, unless the index is exact
+        string             host;
+        long               port    = 0; //As written or the scheme default, 0 if unknown
+        int                retries = 0; //After "429 Too Many Requests"
+        vector<Occurrence> occurrences;
+        State              state = State::Waiting;
+        CheckResult        result;
+    };
+
+    //With "exact" set, URLs are only merged if they're written exactly the same way
+    explicit URLIndex(bool exact = false) : exact(exact) {}
+
+    //Records the link, returns its entry and true if it's the first time the URL is seen
+    pair<Entry*, bool> add(FoundLink &&link);
+
+    //The URL of an occurrence as it's written in its file
+    string_view URL(const Occurrence &occurrence) const { return pool.at(occurrence.URL); }
+
+    size_t uniqueURLs() const  { return entries.size(); }
+    size_t occurrences() const { return totalOccurrences; }
+
+    static string normalize(const string &URL) { return normalize(URLParts::parse(URL)); }
+    static string normalize(const URLParts &parts);
+
+private:
+    StringPool pool;            //Spellings and keys of every URL
+    vector<Entry*> bySpelling;  //Entry of each spelling by pool id, a URL written again isn't parsed again
+    unordered_map<string_view, Entry> entries; //Keys are in the pool
+    size_t totalOccurrences = 0;
+    bool   exact;
+};
+
+#endif // URLINDEX_H
@@ -0,0 +1,86 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#ifndef WALKER_H
+#define WALKER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class ThreadPool;
+
+/*
+A glob the way .gitignore understands them: "*" and "?" stop at '/', "**" doesn't, [a-z]
+classes. Without a '/' the pattern is tried against the name at any depth, with one it's
+anchored to the directory the pattern comes from. A trailing '/' only matches directories
+and a leading '!' (in .gitignore files) includes again what was excluded before.
+*/
+struct GlobRule
+{
+    string pattern;
+    bool   anchored = false;
+    bool   dirOnly  = false;
+    bool   negate   = false;
+
+    static bool parse(string text, bool allowNegation, GlobRule &rule);
+    bool matches(const string &relative, const string &name, bool isDir) const;
+
+    static bool match(const char *pattern, const char *text);
+};
+
+struct WalkOptions
+{
+    bool recursive = false;
+    vector<GlobRule> include; //Files only, none = every file
+    vector<GlobRule> exclude; //Files and directories
+    bool gitignore = false;   //Honors .gitignore files and skips .git
+    unsigned threads = 1;
+};
+
+/*
+Collects the regular files under a directory in one pass, subdirectories are listed in
+parallel. Excluded directories are pruned before anything in them is read. Files come out
+sorted by name, those of a directory before the ones of its subdirectories, so the order
+doesn't depend on the filesystem nor on the threads.
+*/
+class DirectoryWalker
+{
+public:
+    explicit DirectoryWalker(const WalkOptions &options) : options(options) {}
+
+    //Appends the files found to "files", problems (unreadable directories) go to "errors"
+    //and the directories read (root included) to "directories" when it's given
+    void walk(const string &root, vector<string> &files, vector<string> &errors,
+              vector<string> *directories = nullptr) const;
+
+private:
+    struct IgnoreList;
+    struct Node;
+
+    void list(const string &path, const string &relative, shared_ptr<const IgnoreList> ignores,
+              Node &node, ThreadPool &pool) const;
+    bool excluded(const string &relative, const string &name, bool isDir,
+                  const shared_ptr<const IgnoreList> &ignores) const;
+
+    static shared_ptr<const IgnoreList> readIgnoreFile(const string &path, const string &relative,
+                                                       shared_ptr<const IgnoreList> parent);
+
+    WalkOptions options;
+};
+
+#endif // WALKER_H
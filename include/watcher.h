@@ -0,0 +1,85 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#ifndef WATCHER_H
+#define WATCHER_H
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <fud.h>
+#include <resultcache.h>
+#include <walker.h>
+
+using namespace std;
+
+/*
+--watch: a first scan, then files are scanned again as they're saved. inotify tells which
+directories changed, bursts of events are gathered until they calm down and only the
+changed files are read again. Connections and results stay in memory between scans, so
+URLs that were already checked aren't requested again while they're fresh.
+inotify is Linux only, watch() fails anywhere else.
+*/
+class Watcher
+{
+public:
+    Watcher(const ScanOptions &options, const WalkOptions &walkOptions);
+    ~Watcher();
+
+    Watcher(const Watcher&) = delete;
+    Watcher &operator=(const Watcher&) = delete;
+
+    //Scans "files" then watches them until stop(). New files showing up in "directories"
+    //(walked with the walk options) are watched too. False if nothing can be watched.
+    bool watch(const vector<string> &files, const vector<string> &directories,
+               const ScanCallbacks &callbacks = ScanCallbacks());
+
+    //Safe in a signal handler, the scan going on is finished first
+    void stop();
+
+private:
+    //Waits for changes, false once stopped
+    bool wait(unordered_set<string> &changed, bool &rewalk);
+    void readEvents(unordered_set<string> &changed, bool &rewalk, bool &overflow);
+    void walk(const ScanCallbacks &callbacks, unordered_set<string> &added);
+    void addDirectory(const string &path, const ScanCallbacks &callbacks);
+    void forget(const string &file);
+    void writeReport(const ScanCallbacks &callbacks);
+    static string absolute(const string &path);
+
+    const ScanOptions options;
+    const WalkOptions walkOptions;
+    Scanner           scanner;
+    ResultCache       results; //Memory only unless there's a --cache
+
+    vector<string>                roots;   //Walked again when unknown files show up
+    unordered_map<string, string> known;   //Absolute path of every watched file -> as it was given
+    unordered_set<string>         own;     //Files written by FUD itself, never scanned
+    unordered_map<int, string>    watches; //inotify watch -> absolute directory
+    bool limitReached = false;
+
+    //With a report file: the records of every file, written again in full after each scan
+    //since a rescan only has the records of the files that changed
+    bool mergedReport = false;
+    map<string, vector<ReportRecord>> records; //By file, archive members after their archive
+
+    int notify = -1; //inotify
+    int wakeup = -1; //eventfd written by stop()
+};
+
+#endif // WATCHER_H
@@ -0,0 +1,398 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#include <archive.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <zlib.h>
+
+namespace {
+
+const size_t blockSize = 512; //tar
+
+bool endsWith(const string &text, const char *suffix)
+{
+    const size_t length = strlen(suffix);
+    if (text.size() < length) return false;
+    return equal(text.end() - length, text.end(), suffix, [](char a, char b) { return tolower(a) == b; });
+}
+
+bool isTarHeader(const char *block)
+{
+    if (memcmp(block + 257, "ustar", 5) == 0) return true;
+
+    //Old tar files have no mark, their header checksum has to do
+    unsigned long stored = 0;
+    bool digits = false;
+    for (int i = 148; i < 156 && block[i]; i++) {
+        if (block[i] == ' ') { if (digits) break; continue; }
+        if (block[i] < '0' || block[i] > '7') return false;
+        stored = stored * 8 + (block[i] - '0');
+        digits = true;
+    }
+    unsigned long sum = 0;
+    for (size_t i = 0; i < blockSize; i++) sum += (i >= 148 && i < 156) ? ' ' : (unsigned char)block[i];
+    return digits && sum == stored;
+}
+
+//Octal, or base-256 for big values (GNU)
+uint64_t tarNumber(const char *field, size_t length)
+{
+    uint64_t value = 0;
+    if ((unsigned char)field[0] & 0x80) {
+        for (size_t i = 1; i < length; i++) value = value << 8 | (unsigned char)field[i];
+        return value;
+    }
+    for (size_t i = 0; i < length && field[i]; i++) {
+        if (field[i] == ' ') continue;
+        if (field[i] < '0' || field[i] > '7') break;
+        value = value * 8 + (field[i] - '0');
+    }
+    return value;
+}
+
+string tarString(const char *field, size_t length)
+{
+    return string(field, strnlen(field, length));
+}
+
+uint16_t le16(const char *at) { return (unsigned char)at[0] | (unsigned char)at[1] << 8; }
+uint32_t le32(const char *at) { return le16(at) | (uint32_t)le16(at + 2) << 16; }
+
+} //namespace
+
+
+//Bytes coming out of the archive, in order
+class ArchiveReader::Stream
+{
+public:
+    virtual ~Stream() = default;
+    //Fills "out" with up to "length" bytes, fewer only at the end. -1 on error
+    virtual long read(char *out, size_t length) = 0;
+    virtual string problem() const { return "unexpected end of data"; }
+};
+
+class ArchiveReader::MemoryStream : public Stream
+{
+public:
+    MemoryStream(const char *data, size_t size) : data(data), size(size) {}
+
+    long read(char *out, size_t length) override
+    {
+        length = min(length, size - offset);
+        memcpy(out, data + offset, length);
+        offset += length;
+        return length;
+    }
+
+private:
+    const char *data;
+    size_t size, offset = 0;
+};
+
+class ArchiveReader::GzipStream : public Stream
+{
+public:
+    GzipStream(const char *data, size_t size) : size(size)
+    {
+        stream.next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        stream.avail_in = 0;
+        ready = inflateInit2(&stream, 15 + 16) == Z_OK; //+16: gzip header and trailer
+    }
+    ~GzipStream() override { if (ready) inflateEnd(&stream); }
+
+    long read(char *out, size_t length) override
+    {
+        if (!ready) return -1;
+
+        size_t produced = 0;
+        while (produced < length && !finished) {
+            //zlib counts in 32 bits, big inputs are given in slices
+            if (stream.avail_in == 0 && consumed < size) {
+                stream.avail_in = min<size_t>(size - consumed, 1u << 30);
+                consumed += stream.avail_in;
+            }
+            stream.next_out  = reinterpret_cast<Bytef*>(out + produced);
+            stream.avail_out = min<size_t>(length - produced, 1u << 30);
+            const uInt before = stream.avail_out;
+            const int status = inflate(&stream, Z_NO_FLUSH);
+            produced += before - stream.avail_out;
+
+            if (status == Z_STREAM_END) {
+                //Several gzip members one after the other make one file
+                if (stream.avail_in >= 2 && stream.next_in[0] == 0x1f && stream.next_in[1] == 0x8b) inflateReset(&stream);
+                else finished = true;
+            }
+            else if (status == Z_BUF_ERROR && stream.avail_in == 0 && consumed == size) {
+                error = "truncated gzip data";
+                return -1;
+            }
+            else if (status != Z_OK && status != Z_BUF_ERROR) {
+                error = stream.msg ? stream.msg : "invalid gzip data";
+                return -1;
+            }
+        }
+        return produced;
+    }
+
+    string problem() const override { return error.empty() ? Stream::problem() : error; }
+
+private:
+    z_stream stream{};
+    size_t size, consumed = 0;
+    bool   ready = false, finished = false;
+    string error;
+};
+
+
+ArchiveReader::Format ArchiveReader::detect(const char *data, size_t size, const string &path, string &what)
+{
+    what.clear();
+    //Only files named like archives are opened. Documents built on zip (.docx, .odt, .epub,
+    //.jar...) are full of XML namespace URLs nobody wrote, they're skipped as binary files.
+    const bool gzip = endsWith(path, ".gz") || endsWith(path, ".tgz");
+    if (gzip && size >= 2 && (unsigned char)data[0] == 0x1f && (unsigned char)data[1] == 0x8b) return Gzip;
+    if (endsWith(path, ".zip") && size >= 4 && memcmp(data, "PK\x03\x04", 4) == 0) return Zip;
+    if (endsWith(path, ".zip") && size >= 4 && memcmp(data, "PK\x05\x06", 4) == 0) return Zip; //Empty zip
+    if (endsWith(path, ".tar") && size >= blockSize && isTarHeader(data)) return Tar;
+
+    if (size >= 4 && memcmp(data, "\x28\xb5\x2f\xfd", 4) == 0) what = "zstd";
+    else if (size >= 3 && memcmp(data, "BZh", 3) == 0) what = "bzip2";
+    else if (size >= 6 && memcmp(data, "\xfd" "7zXZ\0", 6) == 0) what = "xz";
+    else if (size >= 6 && memcmp(data, "7z\xbc\xaf\x27\x1c", 6) == 0) what = "7z";
+    else if (size >= 6 && memcmp(data, "Rar!\x1a\x07", 6) == 0) what = "RAR";
+    return what.empty() ? None : Unsupported;
+}
+
+bool ArchiveReader::read(Format format, const char *data, size_t size, const string &path,
+                         uint64_t maxMember, const MemberCallback &member, string &problem)
+{
+    if (format == Zip) return readZip(data, size, maxMember, member, problem);
+    if (format == Tar) {
+        MemoryStream stream(data, size);
+        return readTar(stream, nullptr, maxMember, member, problem);
+    }
+    if (format != Gzip) {
+        problem = "unsupported format";
+        return false;
+    }
+
+    GzipStream stream(data, size);
+
+    //The first block says if it's a tar inside
+    char first[blockSize];
+    const long got = stream.read(first, blockSize);
+    if (got < 0) {
+        problem = stream.problem();
+        return false;
+    }
+    const bool namedTar = endsWith(path, ".tgz") || endsWith(path, ".tar.gz");
+    if ((size_t)got == blockSize && (memcmp(first + 257, "ustar", 5) == 0 || (namedTar && isTarHeader(first))))
+        return readTar(stream, first, maxMember, member, problem);
+
+    //A single compressed file, named like the archive without ".gz"
+    string name = path.substr(path.find_last_of("/\\") + 1);
+    if (endsWith(name, ".gz")) name.erase(name.size() - 3);
+    else if (endsWith(name, ".tgz")) name.replace(name.size() - 4, 4, ".tar");
+
+    string content(first, got);
+    uint64_t total = got;
+    char buffer[1 << 16];
+    long read;
+    while ((read = stream.read(buffer, sizeof(buffer))) > 0) {
+        total += read;
+        if (maxMember > 0 && total > maxMember) {
+            content.clear();
+            content.shrink_to_fit();
+        }
+        else content.append(buffer, read);
+    }
+    if (read < 0) {
+        problem = stream.problem();
+        return false;
+    }
+    if (maxMember > 0 && total > maxMember) content.clear();
+    member(name, move(content), total);
+    return true;
+}
+
+bool ArchiveReader::readTar(Stream &stream, const char *first, uint64_t maxMember,
+                            const MemberCallback &member, string &problem)
+{
+    char header[blockSize];
+    bool haveHeader = first != nullptr;
+    if (haveHeader) memcpy(header, first, blockSize);
+
+    string longName; //GNU 'L' entries and pax "path=" records apply to the next member
+    char buffer[1 << 16];
+
+    while (true) {
+        if (!haveHeader && stream.read(header, blockSize) != (long)blockSize) {
+            problem = stream.problem();
+            return false;
+        }
+        haveHeader = false;
+
+        //Two zero blocks end the archive, one is enough for us
+        if (all_of(header, header + blockSize, [](char c) { return c == 0; })) return true;
+        if (!isTarHeader(header)) {
+            problem = "invalid tar header";
+            return false;
+        }
+
+        const char type = header[156];
+        const uint64_t size = tarNumber(header + 124, 12);
+        const uint64_t padded = (size + blockSize - 1) / blockSize * blockSize;
+
+        string name;
+        if (!longName.empty()) name = move(longName);
+        else {
+            name = tarString(header, 100);
+            const string prefix = tarString(header + 345, 155);
+            if (memcmp(header + 257, "ustar\0", 6) == 0 && !prefix.empty()) name = prefix + '/' + name;
+        }
+        longName.clear();
+
+        //Metadata entries are small, they're read whole
+        const bool metadata = type == 'L' || type == 'x';
+        const bool regular  = type == '0' || type == '\0' || type == '7';
+        const bool keep     = metadata || (regular && (maxMember == 0 || size <= maxMember));
+
+        string content;
+        if (keep) content.reserve(metadata ? min<uint64_t>(size, 1 << 20) : size);
+        for (uint64_t left = padded; left > 0;) {
+            const size_t part = min<uint64_t>(left, sizeof(buffer));
+            if (stream.read(buffer, part) != (long)part) {
+                problem = stream.problem();
+                return false;
+            }
+            const uint64_t done = padded - left;
+            if (keep && done < size) content.append(buffer, min<uint64_t>(part, size - done));
+            left -= part;
+        }
+
+        if (type == 'L') longName = tarString(content.data(), content.size());
+        else if (type == 'x') {
+            //"length path=value\n" records
+            for (size_t at = 0; at < content.size();) {
+                const size_t space = content.find(' ', at);
+                const size_t length = strtoul(content.c_str() + at, nullptr, 10);
+                if (space == string::npos || length == 0 || at + length > content.size()) break;
+                if (content.compare(space + 1, 5, "path=") == 0)
+                    longName = content.substr(space + 6, at + length - space - 7);
+                at += length;
+            }
+        }
+        else if (regular) member(name, move(content), size);
+    }
+}
+
+bool ArchiveReader::readZip(const char *data, size_t size, uint64_t maxMember,
+                            const MemberCallback &member, string &problem)
+{
+    //The end of central directory record is in the last 64 KiB (its comment is at most that)
+    const size_t endSize = 22;
+    if (size < endSize) {
+        problem = "truncated zip archive";
+        return false;
+    }
+    size_t end = size - endSize;
+    const size_t lowest = size > endSize + 0xffff ? size - endSize - 0xffff : 0;
+    while (memcmp(data + end, "PK\x05\x06", 4) != 0) {
+        if (end == lowest) {
+            problem = "zip central directory not found";
+            return false;
+        }
+        end--;
+    }
+
+    const uint16_t entries   = le16(data + end + 10);
+    const uint32_t dirSize   = le32(data + end + 12);
+    const uint32_t dirOffset = le32(data + end + 16);
+    if (dirOffset == 0xffffffff || entries == 0xffff) {
+        problem = "zip64 archives are not supported";
+        return false;
+    }
+    if ((uint64_t)dirOffset + dirSize > size) {
+        problem = "invalid zip central directory";
+        return false;
+    }
+
+    size_t at = dirOffset;
+    for (uint16_t e = 0; e < entries; e++) {
+        if (at + 46 > size || memcmp(data + at, "PK\x01\x02", 4) != 0) {
+            problem = "invalid zip central directory";
+            return false;
+        }
+        const uint16_t flags      = le16(data + at + 8);
+        const uint16_t method     = le16(data + at + 10);
+        const uint32_t packed     = le32(data + at + 20);
+        const uint32_t unpacked   = le32(data + at + 24);
+        const uint16_t nameLength = le16(data + at + 28);
+        const uint16_t extra      = le16(data + at + 30);
+        const uint16_t comment    = le16(data + at + 32);
+        const uint32_t local      = le32(data + at + 42);
+        if (at + 46 + nameLength > size) {
+            problem = "invalid zip central directory";
+            return false;
+        }
+        const string name(data + at + 46, nameLength);
+        at += 46 + nameLength + extra + comment;
+
+        //Directories, encrypted members and methods other than stored/deflate are skipped
+        if (name.empty() || name.back() == '/' || (flags & 1) || (method != 0 && method != 8)) continue;
+        if (maxMember > 0 && unpacked > maxMember) {
+            member(name, string(), unpacked);
+            continue;
+        }
+
+        if ((uint64_t)local + 30 > size || memcmp(data + local, "PK\x03\x04", 4) != 0) {
+            problem = "invalid zip member \"" + name + "\"";
+            return false;
+        }
+        const size_t start = local + 30 + le16(data + local + 26) + le16(data + local + 28);
+        if ((uint64_t)start + packed > size) {
+            problem = "truncated zip member \"" + name + "\"";
+            return false;
+        }
+
+        string content;
+        if (method == 0) content.assign(data + start, packed);
+        else {
+            content.resize(unpacked);
+            z_stream stream{};
+            if (inflateInit2(&stream, -15) != Z_OK) { //Raw deflate, no header
+                problem = "zlib failure";
+                return false;
+            }
+            stream.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(data + start));
+            stream.avail_in  = packed;
+            stream.next_out  = reinterpret_cast<Bytef*>(&content[0]);
+            stream.avail_out = unpacked;
+            const int status = inflate(&stream, Z_FINISH);
+            const size_t produced = unpacked - stream.avail_out;
+            inflateEnd(&stream);
+            if (status != Z_STREAM_END && !(status == Z_BUF_ERROR && produced == unpacked)) {
+                problem = "invalid deflate data in \"" + name + "\"";
+                return false;
+            }
+            content.resize(produced);
+        }
+        member(name, move(content), unpacked);
+    }
+    return true;
+}
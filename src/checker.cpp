@@ -14,184 +14,489 @@
 *****************************************************************************/
 
 #include <checker.h>
+#include <linkchecker.h>
 
-const vector<DiagnosedFile> Checker::extractURLS()
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+
+namespace {
+
+//Files bigger than this are split at line boundaries so several threads can scan them
+const size_t chunkSize = 4 << 20;
+
+struct FoundURL
 {
-    vector<DiagnosedFile> dFiles;
-    vector<string> existingLinks;
+    string URL;
+    long   lineNum;  //Counted from the beginning of the chunk
+    int    position;
+};
 
-    for(const string &file: files) {
-        if (verbose) cout << "Reading \"" << file << "\"...\n";
+struct ScannedChunk
+{
+    long newlines = 0; //Only needed for chunks followed by others
+    vector<FoundURL> URLs;
+};
 
-        ifstream reader(file);
-        if (reader.is_open() && !reader.fail()) {
-            DiagnosedFile currentFile;
-            currentFile.path = file;
-            currentFile.name = baseName(file);
-
-            string line; long lineNum = 1;
-            while (getline(reader, line)) {
-                regex self_regex("(http:\\/\\/|ftp:\\/\\/|https:\\/\\/|www\\.)([\\w_-]+(?:(?:\\.[\\w_-]+)+))([\\w.,@?^=%&:\\/~+#-]*[\\w@?^=%&\\/~+#-])?",
-                regex_constants::ECMAScript | regex_constants::icase);
-                smatch match;
-                if (regex_search(line, match, self_regex)) {
-                    if (verbose) cout << "\tURL detected: \"" << match[0] << "\", Line:" << lineNum << ", at:" << match.position()+1 << endl;
-
-                    if (std::find(existingLinks.begin(), existingLinks.end(), match[0]) != existingLinks.end()) {
-                        if (verbose) dye("\tDuplicate URL detected!\n", warn);
-                        if (!duplicateCheck) continue;
-                    }
-
-                    currentFile.lineNums.push_back(lineNum);
-                    currentFile.positions.push_back(match.position(0)+1);
-                    currentFile.allLinks.push_back(match[0]);
-
-                    existingLinks.push_back(match[0]);
-                }
-                lineNum++;
-            }
-            dFiles.push_back(currentFile);
-        }
+struct ScannedFile
+{
+    bool opened = false;
+    vector<ScannedChunk> chunks;
+    atomic<size_t> pendingChunks{0};
+
+    //With --incremental: what's recorded for the next run, and the
+    //previous record when the file didn't change since then
+    FileManifest::Record record;
+    const FileManifest::Record *unchanged = nullptr;
+    bool read = false; //Opened to compare its content
+
+    //Not scanned: binary or too big, "bytes" is what it would have cost
+    string   skipped;
+    uint64_t bytes = 0;
+    bool     transcoded = false; //UTF-16 turned into UTF-8 first
+
+    //Archives: each member is scanned whole by the thread reading the archive
+    struct Member
+    {
+        string       name;
+        ScannedChunk chunk;
+        string       skipped;
+        uint64_t     bytes = 0;
+        bool         transcoded = false;
+    };
+    bool           archive = false;
+    vector<Member> members;
+    string         problem; //Why the archive couldn't be read to the end
+};
+
+//How many links can wait between extraction and checking
+const size_t linkQueueSize = 4096;
+
+void scanChunk(const char *text, size_t size, bool countAll, ScannedChunk &chunk)
+{
+    LineCounter lines(text);
+    URLMatch match;
+    size_t from = 0;
+    while (URLScanner::find(text, size, from, match)) {
+        from = match.offset + match.length;
+        lines.advance(match.offset);
+        chunk.URLs.push_back({string(text + match.offset, match.length),
+                              lines.line(), lines.column(match.offset)});
+    }
+    if (countAll) {
+        lines.advance(size);
+        chunk.newlines = lines.line() - 1;
+    }
+}
+
+//HTML and Markdown are scanned whole since a tag can span lines. Their relative links
+//are resolved against "path" and merged with the absolute URLs in the order of the text.
+void scanMarkup(const char *text, size_t size, const string &path, MarkupScanner::Kind kind, ScannedChunk &chunk)
+{
+    scanChunk(text, size, false, chunk);
+
+    vector<MarkupScanner::Link> links;
+    string base;
+    MarkupScanner::links(text, size, kind, links, base);
+
+    vector<FoundURL> relative;
+    LineCounter lines(text);
+    for (auto &link: links) {
+        //Already found by the scanner
+        if (URLScanner::matchAt(text + link.offset, text + size) > 0) continue;
+
+        string URL = MarkupScanner::resolve(path, base, link.target);
+        if (URL.empty()) continue;
+        lines.advance(link.offset);
+        relative.push_back({move(URL), lines.line(), lines.column(link.offset)});
+    }
+    if (relative.empty()) return;
+
+    vector<FoundURL> merged;
+    merged.reserve(chunk.URLs.size() + relative.size());
+    merge(make_move_iterator(chunk.URLs.begin()), make_move_iterator(chunk.URLs.end()),
+          make_move_iterator(relative.begin()), make_move_iterator(relative.end()), back_inserter(merged),
+          [](const FoundURL &a, const FoundURL &b) { return a.lineNum < b.lineNum || (a.lineNum == b.lineNum && a.position < b.position); });
+    chunk.URLs = move(merged);
+}
+
+//Only text is worth scanning, UTF-16 is turned into UTF-8 first ("text" and "size" then
+//point into "converted"). False when the content is binary, "skipped" says why.
+bool prepareText(const char *&text, size_t &size, shared_ptr<const string> &converted,
+                 string &skipped, bool &transcoded)
+{
+    string format;
+    const ContentSniffer::Kind kind = ContentSniffer::sniff(text, size, format);
+    if (kind == ContentSniffer::Binary) {
+        skipped = format.empty() ? "binary" : "binary, " + format;
+        return false;
+    }
+    if (kind != ContentSniffer::Text) {
+        converted  = make_shared<const string>(ContentSniffer::toUTF8(text, size, kind));
+        transcoded = true;
+        text = converted->data();
+        size = converted->size();
+    }
+    return true;
+}
+
+void scanArchive(ArchiveReader::Format format, const char *data, size_t size, const string &path,
+                 uintmax_t maxFileSize, ScannedFile &scanned)
+{
+    scanned.archive = true;
+    const auto member = [&scanned, maxFileSize](const string &name, string &&content, uint64_t fullSize) {
+        ScannedFile::Member found;
+        found.name  = name;
+        found.bytes = fullSize;
+        if (maxFileSize > 0 && fullSize > maxFileSize) found.skipped = "bigger than --max-file-size";
         else {
-            dye("Failed to open/read \"" + file + "\".\n", error);
+            const char *text = content.data();
+            size_t length = content.size();
+            shared_ptr<const string> converted;
+            if (prepareText(text, length, converted, found.skipped, found.transcoded))
+                scanChunk(text, length, false, found.chunk);
+        }
+        scanned.members.push_back(move(found));
+    };
+    ArchiveReader::read(format, data, size, path, maxFileSize, member, scanned.problem);
+}
+
+//Opens the file and scans it, big files are split and their chunks handed to the pool.
+//"finished" is called with "index" once every chunk is done (or if the file can't be read).
+void scanFile(ThreadPool &pool, const string &path, size_t index, ScannedFile &scanned,
+              const FileManifest *manifest, uintmax_t maxFileSize, bool localLinks,
+              const function<void(size_t)> &finished)
+{
+    const FileManifest::Record *previous = manifest ? manifest->find(path) : nullptr;
+    if (manifest) {
+        error_code failed;
+        scanned.record.size = filesystem::file_size(path, failed);
+        if (!failed) scanned.record.mtime = filesystem::last_write_time(path, failed).time_since_epoch().count();
+
+        //Same size and date: not even opened
+        if (!failed && previous && previous->size == scanned.record.size && previous->mtime == scanned.record.mtime) {
+            scanned.opened    = true;
+            scanned.unchanged = previous;
+            scanned.record.hash = previous->hash;
+            finished(index);
+            return;
         }
     }
-    return dFiles;
+
+    //Checked before opening, reading a file that can't be mapped costs its whole size
+    if (maxFileSize > 0) {
+        error_code failed;
+        const uintmax_t fileSize = filesystem::file_size(path, failed);
+        if (!failed && fileSize > maxFileSize) {
+            scanned.opened  = true;
+            scanned.skipped = "bigger than --max-file-size";
+            scanned.bytes   = fileSize;
+            finished(index);
+            return;
+        }
+    }
+
+    const auto reader = make_shared<const MappedFile>(path);
+    if (!reader->isOpen()) {
+        finished(index);
+        return;
+    }
+    scanned.opened = true;
+
+    const char *text = reader->data();
+    size_t size = reader->size();
+
+    //Touched but not modified (a fresh checkout for example): the content decides
+    if (manifest) {
+        scanned.read = true;
+        scanned.record.hash = FileManifest::hash(text, size);
+        if (previous && previous->size == size && previous->hash == scanned.record.hash) {
+            scanned.unchanged = previous;
+            finished(index);
+            return;
+        }
+    }
+
+    //Archives and compressed files are read in memory, member by member
+    string unsupported;
+    const ArchiveReader::Format format = ArchiveReader::detect(text, size, path, unsupported);
+    if (format == ArchiveReader::Unsupported) {
+        scanned.skipped = unsupported + " archive, not supported";
+        scanned.bytes   = size;
+        finished(index);
+        return;
+    }
+    if (format != ArchiveReader::None) {
+        scanArchive(format, text, size, path, maxFileSize, scanned);
+        finished(index);
+        return;
+    }
+
+    shared_ptr<const string> converted;
+    if (!prepareText(text, size, converted, scanned.skipped, scanned.transcoded)) {
+        scanned.bytes = size;
+        finished(index);
+        return;
+    }
+
+    const MarkupScanner::Kind markup = localLinks ? MarkupScanner::kindOf(path) : MarkupScanner::None;
+    if (markup != MarkupScanner::None) {
+        scanned.chunks.resize(1);
+        scanMarkup(text, size, path, markup, scanned.chunks[0]);
+        finished(index);
+        return;
+    }
+
+    //Chunks end right after a newline, a URL never contains one so none is cut in half
+    vector<pair<size_t, size_t>> ranges;
+    size_t begin = 0;
+    while (size - begin > chunkSize) {
+        const void *newline = memchr(text + begin + chunkSize, '\n', size - begin - chunkSize);
+        if (!newline) break;
+        const size_t end = static_cast<const char*>(newline) - text + 1;
+        ranges.push_back({begin, end});
+        begin = end;
+    }
+    ranges.push_back({begin, size});
+
+    scanned.chunks.resize(ranges.size());
+    scanned.pendingChunks = ranges.size();
+    for (size_t c = 1; c < ranges.size(); c++) {
+        pool.submit([reader, converted, text, range = ranges[c], more = c + 1 < ranges.size(),
+                     &scanned, &chunk = scanned.chunks[c], &finished, index] {
+            scanChunk(text + range.first, range.second - range.first, more, chunk);
+            if (--scanned.pendingChunks == 0) finished(index);
+        });
+    }
+    scanChunk(text, ranges[0].second, ranges.size() > 1, scanned.chunks[0]);
+    if (--scanned.pendingChunks == 0) finished(index);
 }
 
+} //namespace
+
 
-void Checker::checkURLs(const vector<DiagnosedFile> &diagnosedFiles)
+void reportProblem(const ScanOptions &options, const ScanCallbacks &callbacks, const string &message, Color color)
 {
-    if (files.size() < 1) {
-        dye("Hmm, weird... files list is empty but for some reason this function was called. ", error);
-        throw (001);
+    if (options.console) dye(message, color, options.ansi);
+    if (callbacks.problem) {
+        size_t length = message.size();
+        while (length > 0 && message[length - 1] == '\n') length--;
+        callbacks.problem(message.substr(0, length));
     }
-    if (diagnosedFiles.size() < 1) {
-        dye("Lookes like there's no URLs to check, probably files reading/opening problem. "
-            "If you didn't face any files errors then please make sure the files have URLs in them.", error);
-        throw (002);
+}
+
+Checker::Checker(const vector<string> &files, const ScanOptions &options,
+                 const ScanCallbacks &callbacks, CURLSH *share, ResultCache *results) :
+    options(options),
+    callbacks(callbacks),
+    verbose(options.verbose && options.console),
+    share(share),
+    results(results),
+    files(files)
+{
+}
+
+void Checker::scanFiles(const function<void(size_t)> &fileOpened,
+                        const function<void(FoundLink&&)> &linkFound)
+{
+    paths.clear();
+
+    if (verbose) cout << "URL prefilter: " << AnchorFilter::implementation() << '\n';
+
+    unique_ptr<FileManifest> manifest;
+    if (!options.manifestPath.empty()) {
+        manifest = make_unique<FileManifest>(options.manifestPath);
+        if (!manifest->isUsable())
+            reportProblem(options, callbacks, "\"" + options.manifestPath + "\" is not a manifest, it won't be used nor overwritten.\n", warn);
+        else if (verbose) cout << "Manifest has " << manifest->size() << " file(s).\n";
     }
+    const FileManifest *previous = manifest && manifest->isUsable() ? manifest.get() : nullptr;
+    size_t untouched = 0, hashed = 0;
+    size_t skippedFiles = 0, skippedMembers = 0, transcoded = 0;
+    uint64_t skippedBytes = 0;
+
+    //Each file (or chunk) is scanned in parallel and has its own slot for results
+    vector<ScannedFile> scannedFiles(files.size());
+    vector<char> scanned(files.size(), false);
+    mutex scannedLock;
+    condition_variable fileScanned;
 
-    CURL *curl = curl_easy_init();
-    string data;
+    const function<void(size_t)> finished = [&](size_t index) {
+        {
+            lock_guard<mutex> guard(scannedLock);
+            scanned[index] = true;
+        }
+        fileScanned.notify_all();
+    };
 
-    if (curl) {
-        if (verbose) cout << "Verbose mode is enabled.\n";
+    //Declared last so its threads are joined before anything they use goes away
+    ThreadPool pool(options.threads > 0 ? options.threads : ThreadPool::defaultThreads());
+    if (verbose) cout << "Reading files using " << pool.size() << " thread(s)...\n";
 
-        //Time out in seconds
-        if (verbose) cout << "Timeout: " << timeout << endl;
-        curl_easy_setopt(curl, CURLOPT_TIMEOUT, timeout);
+    //Only a window of files is read ahead of the merge, so
+    //memory stays flat even when the consumer is slow
+    const size_t window = pool.size() * 4;
+    size_t submitted = 0;
+    const auto submitNext = [&] {
+        const size_t f = submitted++;
+        pool.submit([&pool, &path = files[f], f, &result = scannedFiles[f], previous, maxFileSize = options.maxFileSize,
+                     localLinks = options.localLinks, &finished] {
+            scanFile(pool, path, f, result, previous, maxFileSize, localLinks, finished);
+        });
+    };
+    while (submitted < files.size() && submitted < window) submitNext();
 
-        //Follow HTTP redirects if necessary, by default it's disabled
-        const string followRedirectsStr = followRedirects ? "YES" : "NO";
-        if (verbose) cout << "Follow Redirects?: " << followRedirectsStr << endl;
-        if (followRedirects)
-            curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    //Results are merged in the original files order, so links
+    //come out exactly like when files are read one by one.
+    for (size_t f = 0; f < files.size(); f++) {
+        {
+            unique_lock<mutex> guard(scannedLock);
+            fileScanned.wait(guard, [&] { return scanned[f]; });
+        }
+        if (submitted < files.size()) submitNext();
 
-        if (verbose) cout << "Maximum Redirects: " << maxRedirects << endl;
-        curl_easy_setopt(curl, CURLOPT_MAXREDIRS, maxRedirects);
+        const string &file = files[f];
+        ScannedFile &result = scannedFiles[f];
 
-        if (CURL_REDIRECT_PROTOCOL_ALL)
-            curl_easy_setopt(curl, CURLOPT_REDIR_PROTOCOLS, CURLPROTO_ALL);
-        else {
-            curl_easy_setopt(curl, CURLOPT_REDIR_PROTOCOLS, (CURL_REDIRECT_PROTOCOL_HTTP   ? CURLPROTO_HTTP   : 0) |
-                                                            (CURL_REDIRECT_PROTOCOL_HTTPS  ? CURLPROTO_HTTPS  : 0) |
-                                                            (CURL_REDIRECT_PROTOCOL_FTP    ? CURLPROTO_FTP    : 0) |
-                                                            (CURL_REDIRECT_PROTOCOL_FTPS   ? CURLPROTO_FTPS   : 0) |
-                                                            (CURL_REDIRECT_PROTOCOL_FILE   ? CURLPROTO_FILE   : 0) |
-                                                            (CURL_REDIRECT_PROTOCOL_GOPHER ? CURLPROTO_GOPHER : 0) |
-                                                            (CURL_REDIRECT_PROTOCOL_IMAP   ? CURLPROTO_IMAP   : 0) |
-                                                            (CURL_REDIRECT_PROTOCOL_IMAPS  ? CURLPROTO_IMAPS  : 0) |
-                                                            (CURL_REDIRECT_PROTOCOL_LDAP   ? CURLPROTO_LDAP   : 0) |
-                                                            (CURL_REDIRECT_PROTOCOL_LDAPS  ? CURLPROTO_LDAPS  : 0) |
-                                                            (CURL_REDIRECT_PROTOCOL_POP3   ? CURLPROTO_POP3   : 0) |
-                                                            (CURL_REDIRECT_PROTOCOL_POP3S  ? CURLPROTO_POP3S  : 0) |
-                                                            (CURL_REDIRECT_PROTOCOL_RTMP   ? CURLPROTO_RTMP   : 0) |
-                                                            (CURL_REDIRECT_PROTOCOL_RTMPE  ? CURLPROTO_RTMPE  : 0) |
-                                                            (CURL_REDIRECT_PROTOCOL_RTMPS  ? CURLPROTO_RTMPS  : 0) |
-                                                            (CURL_REDIRECT_PROTOCOL_RTMPT  ? CURLPROTO_RTMPT  : 0) |
-                                                            (CURL_REDIRECT_PROTOCOL_RTMPTE ? CURLPROTO_RTMPTE : 0) |
-                                                            (CURL_REDIRECT_PROTOCOL_RTMPTS ? CURLPROTO_RTMPTS : 0) |
-                                                            (CURL_REDIRECT_PROTOCOL_RTSP   ? CURLPROTO_RTSP   : 0) |
-                                                            (CURL_REDIRECT_PROTOCOL_SCP    ? CURLPROTO_SCP    : 0) |
-                                                            (CURL_REDIRECT_PROTOCOL_SFTP   ? CURLPROTO_SFTP   : 0) |
-                                                            (CURL_REDIRECT_PROTOCOL_SMB    ? CURLPROTO_SMB    : 0) |
-                                                            (CURL_REDIRECT_PROTOCOL_SMBS   ? CURLPROTO_SMBS   : 0) |
-                                                            (CURL_REDIRECT_PROTOCOL_SMTP   ? CURLPROTO_SMTP   : 0) |
-                                                            (CURL_REDIRECT_PROTOCOL_SMTPS  ? CURLPROTO_SMTPS  : 0) |
-                                                            (CURL_REDIRECT_PROTOCOL_TELNET ? CURLPROTO_TELNET : 0) |
-                                                            (CURL_REDIRECT_PROTOCOL_TFTP   ? CURLPROTO_TFTP   : 0) |
-                                                            (CURL_REDIRECT_PROTOCOL_DICT   ? CURLPROTO_DICT   : 0)
-                                                            );
-    }
-
-
-        //IPv4 is much faster than IPv6 when it comes to DNS resolution time
-        const string ipv6EnabledStr = ipv6 ? "YES" : "NO";
-        if (verbose) cout << "IPv6 Enabled?: " << ipv6EnabledStr << endl;
-        if (ipv6)
-            curl_easy_setopt(curl, CURLOPT_IPRESOLVE, CURL_IPRESOLVE_V6);
-        else
-            curl_easy_setopt(curl, CURLOPT_IPRESOLVE, CURL_IPRESOLVE_V4);
-
-        //Default scheme is http://, default port is 1080.
-        //A numerical IPv6 address must be written within [brackets]
-        const string useProxyStr = useProxy ? "YES" : "NO";
-        if (verbose) cout << "Use Proxy?: " << useProxyStr << endl;
-        if (verbose && useProxy) cout << "Proxy: " << proxy << endl;
-        if (useProxy && !proxy.empty())
-            curl_easy_setopt(curl, CURLOPT_PROXY, proxy.c_str());
-
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &data);
-
-
-        for (const auto &dFile: diagnosedFiles) {
-            const size_t dFileIndex = &dFile-&diagnosedFiles[0];
-            cout << "-----------------------------------------------------------------------------------------------------\n";
-            cout << (dFileIndex+1) << "/" << diagnosedFiles.size() << " -> Working on file: \"" << dFile.name << "\"" << endl;
-
-            for (const string &URL: dFile.allLinks) {
-
-                const int urlIndex = &URL-&dFile.allLinks[0];
-
-                cout << "\t" << (urlIndex+1) << "/" << dFile.allLinks.size() << " -> Working on URL: \"" << URL << "\"" << endl;
-                if (verbose) cout << "\t\tLine:" << dFile.lineNums.at(urlIndex) << ", at:" << dFile.positions.at(urlIndex) << endl;
-
-                curl_easy_setopt(curl, CURLOPT_URL, URL.c_str());
-
-                timer timer;
-                CURLcode res_code = curl_easy_perform(curl);
-                cout << "\t\tTook: " << timer.getTimeElapsedStr() << endl;
-
-                if (res_code == CURLE_OK) {
-                    long http_code;
-                    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-
-                    if (verbose) cout << "\t\tHTTP response code: " << http_code << endl;
-
-                    if (http_code == 200) {
-                        if (verbose) dye("\t\tGood link: \"" + URL + "\".\n", done);
-                    }
-                    else {
-                        dye("\nIN FILE -> [ " + dFile.name + " ]\tFIXME!\n" +
-                            "\tDEAD LINK: \"" + URL + "\"\n" +
-                            "\tLine:" + to_string(dFile.lineNums.at(urlIndex)) + ", at:" +
-                            to_string(dFile.positions.at(urlIndex)) +
-                            ". Path:\"" + dFile.path + "\"\n\n", warn);
-                    }
+        if (verbose) cout << "Reading \"" << file << "\"...\n";
+
+        if (result.opened && result.archive) {
+            for (auto &member: result.members) {
+                const string memberPath = file + "!/" + member.name;
+                if (!member.skipped.empty()) {
+                    if (verbose) cout << "\tSkipped \"" << memberPath << "\" (" << member.skipped << ").\n";
+                    skippedMembers++;
+                    skippedBytes += member.bytes;
+                    continue;
                 }
-                else {
-                    if (res_code == 28) dye("\t\tRequest was timed out (" + to_string(timeout) + " sec).\n", error);
-                    else {
-                        const string err_msg = curl_easy_strerror(res_code);
-                        dye("\t\t" + err_msg + "\n", error);
-                    }
-                    if (verbose) cout << "\t\tCURL response code: " << res_code << endl;
+                if (member.transcoded) transcoded++;
+
+                const size_t pathIndex = paths.add(memberPath);
+                fileOpened(pathIndex);
+                for (auto &found: member.chunk.URLs) {
+                    if (verbose) cout << "\tURL detected: \"" << found.URL << "\", in \"" << member.name << "\", Line:" << found.lineNum << ", at:" << found.position << '\n';
+                    linkFound({pathIndex, found.lineNum, found.position, move(found.URL)});
                 }
             }
+            if (verbose) cout << "\tArchive, " << result.members.size() << " member(s).\n";
+            if (!result.problem.empty())
+                reportProblem(options, callbacks, "Failed to read \"" + file + "\" to the end: " + result.problem + ".\n", warn);
+            result.members = {};
+        }
+        else if (result.opened && !result.skipped.empty()) {
+            if (verbose) cout << "\tSkipped (" << result.skipped << ").\n";
+            skippedFiles++;
+            skippedBytes += result.bytes;
+            //Nothing to find in it until it changes
+            if (previous) manifest->update(file, move(result.record));
         }
+        else if (result.opened && result.unchanged) {
+            const size_t pathIndex = paths.add(file);
+            fileOpened(pathIndex);
+            if (result.read) hashed++;
+            else untouched++;
+            if (verbose) cout << "\tUnchanged since the last run, " << result.unchanged->occurrences.size() << " URL(s) recorded.\n";
 
-        curl_easy_cleanup(curl);
+            for (const auto &occurrence: result.unchanged->occurrences)
+                linkFound({pathIndex, occurrence.lineNum, occurrence.position, occurrence.URL});
+            result.record.occurrences = result.unchanged->occurrences;
+            manifest->update(file, move(result.record));
+        }
+        else if (result.opened) {
+            const size_t pathIndex = paths.add(file);
+            fileOpened(pathIndex);
+            if (result.transcoded) {
+                transcoded++;
+                if (verbose) cout << "\tUTF-16 text, scanned as UTF-8.\n";
+            }
+
+            long linesBefore = 0;
+            for (auto &chunk: result.chunks) {
+                for (auto &found: chunk.URLs) {
+                    const long lineNum = linesBefore + found.lineNum;
+
+                    if (verbose) cout << "\tURL detected: \"" << found.URL << "\", Line:" << lineNum << ", at:" << found.position << '\n';
+
+                    if (previous) result.record.occurrences.push_back({lineNum, found.position, found.URL});
+                    linkFound({pathIndex, lineNum, found.position, move(found.URL)});
+                }
+                linesBefore += chunk.newlines;
+                chunk.URLs = {}; //A big file has many chunks, each one is freed once merged
+            }
+            result.chunks = {};
+            if (previous) manifest->update(file, move(result.record));
+        }
+        else {
+            reportProblem(options, callbacks, "Failed to open/read \"" + file + "\".\n", error);
+        }
+    }
+
+    if (verbose && (skippedFiles > 0 || skippedMembers > 0 || transcoded > 0))
+        cout << "Skipped " << skippedFiles << " binary or oversized file(s) and " << skippedMembers << " archive member(s), "
+             << skippedBytes << " byte(s) not scanned. "
+             << transcoded << " UTF-16 file(s) transcoded.\n";
+
+    if (previous) {
+        if (options.console)
+                cout << "Incremental scan: " << untouched << " file(s) unchanged, " << hashed << " with the same content, "
+                 << files.size() - untouched - hashed - skippedFiles << " scanned.\n";
+        if (!manifest->save()) reportProblem(options, callbacks, "Failed to save the manifest \"" + options.manifestPath + "\".\n", error);
+    }
+}
+
+ExtractedLinks Checker::extractURLS()
+{
+    ExtractedLinks extracted;
+
+    scanFiles([](size_t) {},
+              [&](FoundLink &&link) {
+                  extracted.occurrences.push_back({uint32_t(link.fileIndex), extracted.URLs.intern(link.URL),
+                                                   uint32_t(link.lineNum), uint32_t(link.position)});
+              });
+    for (size_t i = 0; i < paths.size(); i++) extracted.files.push_back(paths.at(i));
+
+    return extracted;
+}
+
+void Checker::extractURLS(LinkQueue &queue)
+{
+    scanFiles([](size_t) {}, [&](FoundLink &&link) { queue.push(move(link)); });
+    queue.close();
+}
+
+
+void Checker::checkURLs(LinkQueue &queue, ScanSummary &summary)
+{
+    LinkChecker linkChecker(paths, options, callbacks, share, results);
+    linkChecker.run(queue, summary);
+}
+
+ScanSummary Checker::run()
+{
+    ScanSummary summary;
+    if (files.empty()) return summary;
+
+    if (options.console) {
+        cout << "-----------------------------------------------------------------------------------------------------\n";
+        cout << "Checking URLs using up to " << max(options.jobs, 1) << " simultaneous request(s)...\n";
+    }
+
+    //Requests start while the files are still being read, the queue is bounded
+    //so the extraction is slowed down instead of piling up links in memory.
+    timer elapsed;
+    LinkQueue queue(linkQueueSize);
+    thread extraction([this, &queue] { extractURLS(queue); });
+    checkURLs(queue, summary);
+    extraction.join();
+    summary.files   = paths.size();
+    summary.elapsed = elapsed.getTimeElapsed();
+
+    if (!options.console) return summary;
+    if (summary.URLs < 1) {
+        dye("Lookes like there's no URLs to check, probably files reading/opening problem. "
+            "If you didn't face any files errors then please make sure the files have URLs in them.\n", error, options.ansi);
+        return summary;
     }
+    cout << "Checked " << summary.URLs << " URL(s) in " << elapsed.getTimeElapsedStr() << ".\n";
+    return summary;
 }
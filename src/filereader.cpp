@@ -0,0 +1,114 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#include <filereader.h>
+
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #define FUD_MMAP 1
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+namespace {
+    const size_t blockSize = 1 << 20; //1 MiB reads when the file can't be mapped
+    const size_t alignment = 64;
+}
+
+MappedFile::MappedFile(const string &path)
+{
+    #ifdef FUD_MMAP
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+        length = info.st_size;
+        if (length == 0) { //Nothing to map
+            opened = true;
+            ::close(fd);
+            return;
+        }
+
+        void *address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED) {
+            #ifdef MADV_SEQUENTIAL
+            madvise(address, length, MADV_SEQUENTIAL);
+            #endif
+            bytes  = static_cast<const char*>(address);
+            opened = mapped = true;
+            ::close(fd);
+            return;
+        }
+    }
+    ::close(fd);
+    #endif
+
+    opened = readBlocks(path);
+}
+
+MappedFile::~MappedFile()
+{
+    #ifdef FUD_MMAP
+    if (mapped) munmap(const_cast<char*>(bytes), length);
+    #endif
+    if (buffer) ::operator delete[](buffer, align_val_t(alignment));
+}
+
+bool MappedFile::readBlocks(const string &path)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+
+    size_t capacity = 0, used = 0;
+    length = 0;
+    while (true) {
+        if (used + blockSize > capacity) {
+            //Grow by doubling, the buffer stays aligned for the vectorized prefilter
+            const size_t newCapacity = capacity ? capacity * 2 : blockSize;
+            char *grown = static_cast<char*>(::operator new[](newCapacity, align_val_t(alignment)));
+            if (used) memcpy(grown, buffer, used);
+            if (buffer) ::operator delete[](buffer, align_val_t(alignment));
+            buffer = grown;
+            capacity = newCapacity;
+        }
+        const size_t got = fread(buffer + used, 1, blockSize, file);
+        used += got;
+        if (got < blockSize) break;
+    }
+    const bool failed = ferror(file);
+    fclose(file);
+
+    bytes  = buffer;
+    length = used;
+    return !failed;
+}
+
+
+void LineCounter::advance(size_t offset)
+{
+    while (counted < offset) {
+        const void *newline = memchr(text + counted, '\n', offset - counted);
+        if (!newline) break;
+        counted = lineStart = static_cast<const char*>(newline) - text + 1;
+        lineNum++;
+    }
+    counted = offset;
+}
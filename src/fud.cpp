@@ -0,0 +1,82 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#include <fud.h>
+#include <checker.h>
+
+SharePool::~SharePool()
+{
+    for (auto share: spare) curl_share_cleanup(share);
+}
+
+CURLSH *SharePool::create()
+{
+    CURLSH *share = curl_share_init();
+    if (!share) return nullptr;
+
+    //A share is only used by the thread of one scan at a time, so it needs no locking
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    return share;
+}
+
+CURLSH *SharePool::acquire()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        if (!spare.empty()) {
+            CURLSH *share = spare.back();
+            spare.pop_back();
+            return share;
+        }
+    }
+    return create();
+}
+
+void SharePool::release(CURLSH *share)
+{
+    if (!share) return;
+    lock_guard<mutex> guard(lock);
+    spare.push_back(share);
+}
+
+
+Scanner::Scanner(const ScanOptions &options) :
+    options(options)
+{
+    //Not thread safe and needed once per process, curl_easy_init() would otherwise do it at a bad time
+    static once_flag curlReady;
+    call_once(curlReady, [] { curl_global_init(CURL_GLOBAL_DEFAULT); });
+}
+
+ScanSummary Scanner::scan(const vector<string> &files, const ScanCallbacks &callbacks)
+{
+    return scan(files, options, callbacks);
+}
+
+ScanSummary Scanner::scan(const vector<string> &files, const ScanOptions &options,
+                          const ScanCallbacks &callbacks, ResultCache *results)
+{
+    CURLSH *share = shares.acquire();
+    ScanSummary summary;
+    {
+        //The checker is gone before the share is given to another scan
+        Checker checker(files, options, callbacks, share, results);
+        summary = checker.run();
+    }
+    shares.release(share);
+    return summary;
+}
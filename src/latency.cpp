@@ -0,0 +1,46 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#include <latency.h>
+
+#include <algorithm>
+#include <cmath>
+
+void LatencyWindow::add(long ms)
+{
+    if (samples.size() < capacity) samples.push_back(ms);
+    else {
+        samples[next] = ms;
+        next = (next + 1) % capacity;
+    }
+}
+
+long LatencyWindow::percentile(double p) const
+{
+    if (samples.empty()) return 0;
+
+    vector<long> sorted(samples);
+    const size_t rank = min(sorted.size() - 1, static_cast<size_t>(ceil(p / 100 * sorted.size())) - (p > 0));
+    nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    return sorted[rank];
+}
+
+long AdaptiveDeadlines::deadline(const string &host) const
+{
+    const auto found = hosts.find(host);
+    if (found == hosts.end() || found->second.size() < minSamples) return ceiling;
+
+    return clamp(found->second.percentile(95) * factor, floor, ceiling);
+}
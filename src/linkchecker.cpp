@@ -0,0 +1,712 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#include <linkchecker.h>
+
+namespace {
+    //How many times a URL is retried after "429 Too Many Requests"
+    const int maxRetries = 3;
+    //Longest pause accepted from a "Retry-After" header, in seconds
+    const long maxRetryAfter = 60;
+    //Host names looked up at the same time, at most
+    const int maxResolverThreads = 16;
+    //Adaptive deadlines never go below this, in milliseconds
+    const long minDeadline = 2000;
+    //Hosts listed in the timings summary
+    const size_t maxSlowHosts = 10;
+
+    //Answers about the server's state at that moment rather than about the URL: timeouts,
+    //rate limits and server errors. They're never cached, the next run asks again.
+    bool isTransient(long http_code)
+    {
+        return http_code == 408 || http_code == 429 || http_code >= 500;
+    }
+}
+
+LinkChecker::LinkChecker(const PathTable &files, const ScanOptions &options,
+                         const ScanCallbacks &callbacks, CURLSH *share, ResultCache *results) :
+    options(options),
+    callbacks(callbacks),
+    verbose(options.verbose && options.console),
+    files(files),
+    share(share),
+    ownShare(!share),
+    index(options.duplicateCheck),
+    scheduler(options.perHost, options.perHostRate, options.breakerThreshold, options.breakerProbe),
+    cache(results)
+{
+}
+
+LinkChecker::~LinkChecker()
+{
+    //Its threads may still wake up the multi handle
+    resolver.reset();
+
+    for (auto &transfer: transfers) {
+        if (!transfer.handle) continue;
+        if (multi) curl_multi_remove_handle(multi, transfer.handle);
+        curl_easy_cleanup(transfer.handle);
+        curl_slist_free_all(transfer.conditions);
+        curl_slist_free_all(transfer.resolve);
+    }
+    if (multi) curl_multi_cleanup(multi);
+    if (share && ownShare) curl_share_cleanup(share);
+}
+
+bool LinkChecker::init()
+{
+    multi = curl_multi_init();
+    if (!share) share = SharePool::create();
+    if (!multi || !share) return false;
+
+    //Same limit as the scheduler, in case redirects lead several URLs to one host
+    curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)max(options.perHost, 1));
+
+    //A pool of easy handles, never more than "jobs" requests are in flight.
+    //Handles are reused so connections can stay alive between requests.
+    transfers = vector<Transfer>(max(options.jobs, 1));
+    for (auto &transfer: transfers) {
+        transfer.handle = curl_easy_init();
+        if (!transfer.handle) continue;
+        setupHandle(&transfer);
+        idle.push_back(&transfer);
+    }
+    return !idle.empty();
+}
+
+void LinkChecker::setupHandle(Transfer *transfer)
+{
+    CURL *curl = transfer->handle;
+    curl_easy_setopt(curl, CURLOPT_SHARE, share);
+
+    //Time out in seconds
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, options.timeout);
+
+    //A host that doesn't even accept the connection shouldn't hold the request for the whole timeout
+    if (options.connectTimeout > 0)
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, options.connectTimeout);
+
+    //Stalled transfers: less than "lowSpeedLimit" bytes per second during "lowSpeedTime" seconds
+    if (options.lowSpeedTime > 0) {
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, options.lowSpeedLimit);
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, options.lowSpeedTime);
+    }
+
+    //Follow HTTP redirects if necessary, by default it's disabled
+    if (options.followRedirects)
+        curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+
+    curl_easy_setopt(curl, CURLOPT_MAXREDIRS, options.maxRedirects);
+
+    curl_easy_setopt(curl, CURLOPT_REDIR_PROTOCOLS, options.redirectProtocols);
+
+    //IPv4 is much faster than IPv6 when it comes to DNS resolution time
+    if (options.ipv6)
+        curl_easy_setopt(curl, CURLOPT_IPRESOLVE, CURL_IPRESOLVE_V6);
+    else
+        curl_easy_setopt(curl, CURLOPT_IPRESOLVE, CURL_IPRESOLVE_V4);
+
+    //Default scheme is http://, default port is 1080.
+    //A numerical IPv6 address must be written within [brackets]
+    if (options.useProxy && !options.proxy.empty())
+        curl_easy_setopt(curl, CURLOPT_PROXY, options.proxy.c_str());
+
+    //Nothing is buffered, and the multi handle gives the transfer
+    //back to us through CURLINFO_PRIVATE when the request is done.
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, transfer);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, headerCallback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, transfer);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, transfer);
+    curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, transfer->errorBuffer);
+}
+
+size_t LinkChecker::headerCallback(const char *in, size_t size, size_t num, Transfer *transfer)
+{
+    const size_t totalBytes(size * num);
+    string line(in, totalBytes);
+    while (!line.empty() && (line.back() == '\r' || line.back() == '\n')) line.pop_back();
+
+    const auto value = [&line](size_t nameLength) {
+        const size_t start = line.find_first_not_of(" \t", nameLength);
+        return start == string::npos ? string() : line.substr(start);
+    };
+
+    //A new status line means a redirect was followed, only the last response counts
+    if (line.compare(0, 5, "HTTP/") == 0) {
+        transfer->etag.clear();
+        transfer->lastModified.clear();
+        transfer->retryAfter = -1;
+    }
+    else if (curl_strnequal(line.c_str(), "ETag:", 5))
+        transfer->etag = value(5);
+    else if (curl_strnequal(line.c_str(), "Last-Modified:", 14))
+        transfer->lastModified = value(14);
+    else if (curl_strnequal(line.c_str(), "Retry-After:", 12)) {
+        //Only the delay in seconds form, an HTTP date falls back to our own backoff
+        const string seconds = value(12);
+        if (!seconds.empty() && all_of(seconds.begin(), seconds.end(), [](char c) { return c >= '0' && c <= '9'; }))
+            transfer->retryAfter = stol(seconds.substr(0, 9));
+    }
+
+    return totalBytes;
+}
+
+//Stale cached results are revalidated, a "304 Not Modified" answer is enough to keep them
+void LinkChecker::setConditions(Transfer *transfer, const CachedResult *cached)
+{
+    curl_slist_free_all(transfer->conditions);
+    transfer->conditions   = nullptr;
+    transfer->revalidating = nullptr;
+
+    if (cached && (!cached->etag.empty() || !cached->lastModified.empty())) {
+        if (!cached->etag.empty())
+            transfer->conditions = curl_slist_append(transfer->conditions, ("If-None-Match: " + cached->etag).c_str());
+        if (!cached->lastModified.empty())
+            transfer->conditions = curl_slist_append(transfer->conditions, ("If-Modified-Since: " + cached->lastModified).c_str());
+        transfer->revalidating = cached;
+    }
+    curl_easy_setopt(transfer->handle, CURLOPT_HTTPHEADER, transfer->conditions);
+}
+
+void LinkChecker::startTransfer(Transfer *transfer, Transfer::Method method)
+{
+    CURL *curl = transfer->handle;
+    transfer->method = method;
+    transfer->bodyAborted = false;
+    transfer->retryAfter = -1;
+    transfer->errorBuffer[0] = '\0';
+    transfer->etag.clear();
+    transfer->lastModified.clear();
+
+    if (method == Transfer::Head) {
+        curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+        curl_easy_setopt(curl, CURLOPT_RANGE, nullptr);
+    }
+    else {
+        //Asking for the first byte only, servers that ignore ranges
+        //are stopped by writeCallback() as soon as the body starts.
+        curl_easy_setopt(curl, CURLOPT_NOBODY, 0L);
+        curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+        curl_easy_setopt(curl, CURLOPT_RANGE, "0-0");
+    }
+
+    curl_easy_setopt(curl, CURLOPT_URL, transfer->entry->URL.data());
+    curl_multi_add_handle(multi, curl);
+}
+
+//Some servers don't implement HEAD or answer it wrongly, those get a ranged GET instead
+bool LinkChecker::headRejected(CURLcode res_code, long http_code)
+{
+    if (res_code == CURLE_GOT_NOTHING) return true;
+    return res_code == CURLE_OK && (http_code == 405 || http_code == 501);
+}
+
+void LinkChecker::reportCheck(const URLIndex::Entry &entry)
+{
+    const CheckResult &result = entry.result;
+
+    cout << "\t" << checked << " -> Checked URL: \"" << entry.URL << "\"\n";
+    if (result.origin == CheckResult::Cache) cout << "\t\tFrom cache\n";
+    else if (result.origin == CheckResult::Local) {
+        if (!result.isGood()) dye("\t\t" + result.details + ".\n", error, options.ansi);
+        else if (verbose) dye("\t\tGood link: \"" + string(entry.URL) + "\".\n", done, options.ansi);
+        return;
+    }
+    else if (result.origin == CheckResult::Skipped) {
+        dye("\t\tHost unreachable, not requested.\n", error, options.ansi);
+        return;
+    }
+    else {
+        cout << "\t\tTook: " << timer::humanReadable(result.elapsed);
+        if (result.origin == CheckResult::Revalidated) cout << " (not modified since last check)";
+        cout << '\n';
+    }
+
+    if (result.curlCode == CURLE_OK) {
+        if (verbose) cout << "\t\tHTTP response code: " << result.httpCode << '\n';
+        if (result.isGood() && verbose) dye("\t\tGood link: \"" + string(entry.URL) + "\".\n", done, options.ansi);
+    }
+    else {
+        if (result.curlCode == CURLE_OPERATION_TIMEDOUT && result.deadline > 0)
+            dye("\t\tRequest was timed out (" + to_string(result.deadline) + " milliseconds, adaptive deadline of the host).\n", error, options.ansi);
+        else if (result.curlCode == CURLE_OPERATION_TIMEDOUT && !result.details.empty())
+            dye("\t\tRequest was timed out: " + result.details + "\n", error, options.ansi);
+        else if (result.curlCode == CURLE_OPERATION_TIMEDOUT) dye("\t\tRequest was timed out (" + to_string(options.timeout) + " sec).\n", error, options.ansi);
+        else {
+            const string err_msg = curl_easy_strerror(result.curlCode);
+            dye("\t\t" + err_msg + "\n", error, options.ansi);
+        }
+        if (verbose) cout << "\t\tCURL response code: " << result.curlCode << '\n';
+    }
+}
+
+//The error message of a result, as shown in reports
+string LinkChecker::failure(const CheckResult &result)
+{
+    if (result.isGood()) return string();
+    if (result.origin == CheckResult::Skipped) return "Host unreachable";
+    if (result.origin == CheckResult::Local) return result.details;
+    if (result.curlCode == CURLE_OK) return "HTTP " + to_string(result.httpCode);
+    return curl_easy_strerror(result.curlCode);
+}
+
+void LinkChecker::reportOccurrence(const URLIndex::Entry &entry, const Occurrence &link)
+{
+    links++;
+    if (!entry.result.isGood()) deadLinks++;
+    if (report || callbacks.link) writeRecord(entry, link);
+    if (entry.result.isGood() || !options.console) return;
+
+    const string &path = files.at(link.file);
+    const string name = path.substr(path.find_last_of("/\\") + 1);
+    const string reason = failure(entry.result);
+
+    dye("\nIN FILE -> [ " + name + " ]\tFIXME!\n" +
+        "\tDEAD LINK: \"" + string(index.URL(link)) + "\" (" + reason + ")\n" +
+        "\tLine:" + to_string(link.line) + ", at:" +
+        to_string(link.column) +
+        ". Path:\"" + path + "\"\n\n", warn, options.ansi);
+}
+
+void LinkChecker::writeRecord(const URLIndex::Entry &entry, const Occurrence &link)
+{
+    static const char *const origins[] = { "network", "cache", "revalidated", "skipped", "local" };
+    const CheckResult &result = entry.result;
+
+    ReportRecord record;
+    record.file      = files.at(link.file);
+    record.line      = link.line;
+    record.column    = link.column;
+    record.URL       = string(index.URL(link));
+    record.finalURL  = result.finalURL;
+    record.status    = result.isGood() ? "good" : result.origin == CheckResult::Skipped ? "unreachable" : "dead";
+    record.httpCode  = result.httpCode;
+    record.curlCode  = result.curlCode;
+    record.error     = result.curlCode == CURLE_OPERATION_TIMEDOUT && !result.details.empty() ? result.details : failure(result);
+    record.origin    = origins[result.origin];
+    record.elapsed   = result.elapsed;
+    record.dns       = result.timings.dns;
+    record.connect   = result.timings.connect;
+    record.tls       = result.timings.tls;
+    record.firstByte = result.timings.firstByte;
+    record.total     = result.timings.total;
+    record.redirects = result.redirects;
+    record.received  = result.received;
+    if (callbacks.link) callbacks.link(record);
+    if (report) report->write(move(record));
+}
+
+//Every occurrence goes to the index, only URLs never seen before are requested.
+//Occurrences of URLs that are already checked are reported right away, the
+//others are reported with the rest when their request is done.
+void LinkChecker::accept(FoundLink &&link)
+{
+    const auto added = index.add(move(link));
+    URLIndex::Entry *entry = added.first;
+    if (!added.second) {
+        if (verbose) dye("\tDuplicate URL: \"" + string(index.URL(entry->occurrences.back())) + "\"\n", warn, options.ansi);
+        if (entry->state == URLIndex::State::Done) reportOccurrence(*entry, entry->occurrences.back());
+        return;
+    }
+
+    //Relative links of HTML and Markdown files, the file system has the answer
+    if (entry->URL.compare(0, 7, "file://") == 0) {
+        const string problem = localLinks.check(string(entry->URL));
+        entry->result.isHTTP   = false;
+        entry->result.curlCode = problem.empty() ? CURLE_OK : CURLE_FILE_COULDNT_READ_FILE;
+        entry->result.details  = problem;
+        entry->result.origin   = CheckResult::Local;
+        complete(*entry);
+        return;
+    }
+
+    //Fresh results of previous runs don't need the network at all
+    const CachedResult *cached = cache ? cache->find(string(entry->key)) : nullptr;
+    if (cached && cache->isFresh(*cached)) {
+        entry->result.httpCode = cached->httpCode;
+        entry->result.isHTTP   = cached->isHTTP;
+        entry->result.finalURL = cached->finalURL;
+        entry->result.origin   = CheckResult::Cache;
+        complete(*entry);
+        return;
+    }
+    schedule(entry);
+}
+
+//The first URL of a host starts its lookup, URLs of hosts being looked up are parked
+void LinkChecker::schedule(URLIndex::Entry *entry)
+{
+    //Only hosts libcurl would connect to directly, IPv6 literals are already addresses
+    if (!resolver || entry->host.empty() || entry->host.front() == '[' || entry->port == 0) {
+        scheduler.add(entry);
+        return;
+    }
+
+    const auto inserted = lookups.try_emplace(entry->host);
+    HostLookup &lookup = inserted.first->second;
+    if (inserted.second) resolver->resolve(entry->host);
+
+    if (!lookup.done) {
+        lookup.parked.push_back(entry);
+        parked++;
+    }
+    else if (lookup.status == HostResolver::Answer::NotFound) unresolved(*entry);
+    else scheduler.add(entry);
+}
+
+void LinkChecker::resolved(vector<HostResolver::Answer> &answers)
+{
+    for (auto &answer: answers) {
+        HostLookup &lookup = lookups[answer.host];
+        lookup.done   = true;
+        lookup.status = answer.status;
+        for (const auto &address: answer.addresses) {
+            if (!lookup.addresses.empty()) lookup.addresses += ',';
+            lookup.addresses += address;
+        }
+
+        if (verbose && answer.status == HostResolver::Answer::NotFound)
+            dye("\tHost \"" + answer.host + "\" doesn't exist, its URLs are dead.\n", warn, options.ansi);
+
+        vector<URLIndex::Entry*> waiting;
+        waiting.swap(lookup.parked);
+        parked -= waiting.size();
+        for (auto entry: waiting) {
+            if (lookup.status == HostResolver::Answer::NotFound) unresolved(*entry);
+            else scheduler.add(entry);
+        }
+    }
+    answers.clear();
+}
+
+//The circuit breaker tripped, what's left of the host isn't requested
+void LinkChecker::skipUnreachable()
+{
+    vector<URLIndex::Entry*> skipped;
+    scheduler.takeUnreachable(skipped);
+    for (auto entry: skipped) {
+        entry->result.curlCode = CURLE_COULDNT_CONNECT;
+        entry->result.isHTTP   = false;
+        entry->result.elapsed  = 0;
+        entry->result.origin   = CheckResult::Skipped;
+        complete(*entry);
+    }
+}
+
+//Dead without a single connection attempt, like libcurl would have reported it
+void LinkChecker::unresolved(URLIndex::Entry &entry)
+{
+    entry.result.curlCode = CURLE_COULDNT_RESOLVE_HOST;
+    entry.result.httpCode = 0;
+    entry.result.isHTTP   = false;
+    entry.result.elapsed  = 0;
+    complete(entry);
+}
+
+void LinkChecker::startWaiting()
+{
+    while (!idle.empty()) {
+        URLIndex::Entry *entry = scheduler.next();
+        if (!entry) return;
+
+        Transfer *transfer = idle.back();
+        idle.pop_back();
+
+        transfer->entry = entry;
+        entry->state = URLIndex::State::Checking;
+        transfer->elapsed.restart();
+        setConditions(transfer, cache ? cache->find(string(entry->key)) : nullptr);
+
+        //libcurl takes the addresses we found instead of resolving the host again
+        curl_slist_free_all(transfer->resolve);
+        transfer->resolve = nullptr;
+        const auto lookup = lookups.find(entry->host);
+        if (lookup != lookups.end() && lookup->second.status == HostResolver::Answer::Resolved) {
+            const string resolve = entry->host + ':' + to_string(entry->port) + ':' + lookup->second.addresses;
+            transfer->resolve = curl_slist_append(nullptr, resolve.c_str());
+        }
+        curl_easy_setopt(transfer->handle, CURLOPT_RESOLVE, transfer->resolve);
+
+        if (deadlines) {
+            const long deadline = deadlines->deadline(HostScheduler::key(*entry));
+            transfer->deadline = deadline < options.timeout * 1000L ? deadline : 0;
+            curl_easy_setopt(transfer->handle, CURLOPT_TIMEOUT_MS, deadline);
+        }
+
+        startTransfer(transfer, options.headRequests ? Transfer::Head : Transfer::RangedGet);
+        active++;
+    }
+}
+
+//libcurl gives times since the start of the request, the sample has the duration of each phase
+RequestSample LinkChecker::measure(Transfer *transfer, CURLcode res_code, long http_code, CheckResult::Timings &timings)
+{
+    CURL *curl = transfer->handle;
+    const auto time = [curl](CURLINFO info) {
+        curl_off_t us = 0;
+        curl_easy_getinfo(curl, info, &us);
+        return (long)us;
+    };
+    timings.dns       = time(CURLINFO_NAMELOOKUP_TIME_T);
+    timings.connect   = time(CURLINFO_CONNECT_TIME_T);
+    timings.tls       = time(CURLINFO_APPCONNECT_TIME_T);
+    timings.firstByte = time(CURLINFO_STARTTRANSFER_TIME_T);
+    timings.total     = time(CURLINFO_TOTAL_TIME_T);
+
+    RequestSample sample;
+    //A reused connection has no connect nor TLS phase, libcurl reports 0 for them
+    const long connected  = max(timings.connect, timings.dns);
+    const long handshaken = max(timings.tls, connected);
+    sample.dns      = timings.dns;
+    sample.connect  = connected - timings.dns;
+    sample.tls      = handshaken - connected;
+    sample.wait     = timings.firstByte > handshaken ? timings.firstByte - handshaken : 0;
+    sample.total    = timings.total;
+    sample.httpCode = http_code;
+    sample.failed   = res_code != CURLE_OK && http_code == 0;
+
+    long headers = 0, request = 0;
+    curl_off_t body = 0;
+    curl_easy_getinfo(curl, CURLINFO_REDIRECT_COUNT, &sample.redirects);
+    curl_easy_getinfo(curl, CURLINFO_HEADER_SIZE, &headers);
+    curl_easy_getinfo(curl, CURLINFO_REQUEST_SIZE, &request);
+    curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &body);
+    sample.received = headers + body;
+    sample.sent     = request;
+    return sample;
+}
+
+void LinkChecker::finish(Transfer *transfer, CURLcode res_code)
+{
+    if (res_code == CURLE_WRITE_ERROR && transfer->bodyAborted) res_code = CURLE_OK;
+
+    long http_code = 0;
+    curl_easy_getinfo(transfer->handle, CURLINFO_RESPONSE_CODE, &http_code);
+    curl_multi_remove_handle(multi, transfer->handle);
+
+    //Every request counts, the rejected HEADs and the rate limited ones too
+    CheckResult::Timings timings;
+    const RequestSample sample = measure(transfer, res_code, http_code, timings);
+    metrics.record(HostScheduler::key(*transfer->entry), sample);
+
+    if (transfer->method == Transfer::Head && headRejected(res_code, http_code)) {
+        if (verbose) cout << "\tHEAD rejected by \"" << transfer->entry->URL << "\", trying a ranged GET...\n";
+        startTransfer(transfer, Transfer::RangedGet);
+        return;
+    }
+
+    //Only failures of the host itself count, not of a host it redirected to
+    const bool reachable = sample.redirects > 0 || (res_code != CURLE_COULDNT_CONNECT && res_code != CURLE_OPERATION_TIMEDOUT);
+
+    URLIndex::Entry &entry = *transfer->entry;
+    scheduler.finished(&entry, reachable);
+    idle.push_back(transfer);
+    active--;
+
+    //Too many requests: the host is paused and the URL waits for its turn again
+    if (res_code == CURLE_OK && http_code == 429 && entry.retries < maxRetries) {
+        const long delay = transfer->retryAfter >= 0 ? min(transfer->retryAfter, maxRetryAfter) * 1000
+                                                     : 1000L << entry.retries;
+        entry.retries++;
+        entry.state = URLIndex::State::Waiting;
+        if (verbose) dye("\tRate limited by \"" + entry.host + "\", retrying in " + to_string(delay) + " milliseconds.\n", warn, options.ansi);
+        scheduler.retryLater(&entry, delay);
+        setConditions(transfer, nullptr);
+        return;
+    }
+
+    entry.result.curlCode = res_code;
+    entry.result.httpCode = http_code;
+    entry.result.elapsed  = transfer->elapsed.getTimeElapsed();
+    entry.result.deadline = transfer->deadline;
+    //Connect, low speed and total timeouts all share the same code
+    if (res_code == CURLE_OPERATION_TIMEDOUT) entry.result.details = transfer->errorBuffer;
+    if (deadlines && res_code == CURLE_OK) deadlines->record(HostScheduler::key(entry), entry.result.elapsed);
+
+    const char *scheme = nullptr, *finalURL = nullptr;
+    curl_easy_getinfo(transfer->handle, CURLINFO_SCHEME, &scheme);
+    curl_easy_getinfo(transfer->handle, CURLINFO_EFFECTIVE_URL, &finalURL);
+    entry.result.isHTTP   = scheme && (curl_strequal(scheme, "http") || curl_strequal(scheme, "https"));
+    entry.result.finalURL = finalURL ? finalURL : "";
+    entry.result.timings   = timings;
+    entry.result.redirects = sample.redirects;
+    entry.result.received  = sample.received;
+
+    if (cache && res_code == CURLE_OK && !isTransient(http_code)) {
+        CachedResult fresh;
+        if (http_code == 304 && transfer->revalidating) {
+            //Nothing changed, the previous answer still stands
+            fresh = *transfer->revalidating;
+            entry.result.httpCode = fresh.httpCode;
+            entry.result.finalURL = fresh.finalURL;
+            entry.result.origin   = CheckResult::Revalidated;
+        }
+        else {
+            fresh.httpCode = http_code;
+            fresh.isHTTP   = entry.result.isHTTP;
+            fresh.finalURL = entry.result.finalURL;
+        }
+        if (!transfer->etag.empty()) fresh.etag = transfer->etag;
+        if (!transfer->lastModified.empty()) fresh.lastModified = transfer->lastModified;
+        fresh.checkedAt = ResultCache::now();
+        cache->store(string(entry.key), fresh);
+    }
+    setConditions(transfer, nullptr);
+
+    complete(entry);
+}
+
+//The result is known, it's reported once and then at every place the URL was found
+void LinkChecker::complete(URLIndex::Entry &entry)
+{
+    entry.state = URLIndex::State::Done;
+    checked++;
+    if (options.console) reportCheck(entry);
+    for (const auto &link: entry.occurrences) reportOccurrence(entry, link);
+}
+
+void LinkChecker::run(LinkQueue &queue, ScanSummary &summary)
+{
+    //The extraction must never wait forever on a full queue, even if we can't check anything
+    const auto discard = [&queue] {
+        FoundLink link;
+        while (queue.pop(link)) {}
+    };
+
+    if (!init()) {
+        reportProblem(options, callbacks, "Failed to initialize the requests engine.\n", error);
+        discard();
+        return;
+    }
+
+    if (verbose) {
+        cout << "Verbose mode is enabled.\n";
+        cout << "Timeout: " << options.timeout << (options.adaptiveTimeout ? ", adaptive per host" : "") << '\n';
+        cout << "Connect Timeout: " << options.connectTimeout << '\n';
+        if (options.lowSpeedTime > 0) cout << "Low Speed Limit: " << options.lowSpeedLimit << " bytes per second during " << options.lowSpeedTime << " sec\n";
+        cout << "Simultaneous requests: " << options.jobs << '\n';
+        cout << "Requests per host: " << options.perHost;
+        if (options.perHostRate > 0) cout << ", " << options.perHostRate << " per second at most";
+        cout << '\n';
+        if (options.breakerThreshold > 0) cout << "Hosts given up after " << options.breakerThreshold << " failure(s) in a row" << (options.breakerProbe ? ", and a last probe" : "") << '\n';
+        cout << "Method: " << (options.headRequests ? "HEAD, ranged GET if rejected" : "ranged GET") << '\n';
+        cout << "Follow Redirects?: " << (options.followRedirects ? "YES" : "NO") << '\n';
+        cout << "Maximum Redirects: " << options.maxRedirects << '\n';
+        cout << "IPv6 Enabled?: " << (options.ipv6 ? "YES" : "NO") << '\n';
+        cout << "Use Proxy?: " << (options.useProxy ? "YES" : "NO") << '\n';
+        if (options.useProxy) cout << "Proxy: " << options.proxy << '\n';
+    }
+
+    if (!cache && !options.cachePath.empty()) {
+        timer loading;
+        ownCache = make_unique<ResultCache>(options.cachePath, options.cacheTTL);
+        cache = ownCache.get();
+        if (!cache->isOpen()) reportProblem(options, callbacks, "Failed to open the cache \"" + options.cachePath + "\", results won't be saved.\n", warn);
+        if (verbose) cout << "Loaded " << cache->size() << " cached result(s) in " << loading.getTimeElapsedStr() << '\n';
+    }
+
+    if (!options.reportFormat.empty()) {
+        ReportWriter::Format format = ReportWriter::JsonLines;
+        ReportWriter::parseFormat(options.reportFormat, format);
+        report = make_unique<ReportWriter>(format, options.reportPath);
+        if (!report->isOpen()) {
+            reportProblem(options, callbacks, "Failed to open the report \"" + options.reportPath + "\", no report will be written.\n", error);
+            report.reset();
+        }
+    }
+
+    //Without a global timeout there's nothing to adapt
+    if (options.adaptiveTimeout && options.timeout > 0) deadlines = make_unique<AdaptiveDeadlines>(options.timeout * 1000L, minDeadline);
+
+    //A proxy resolves the names itself, some of them only exist on its side
+    if (!options.useProxy) {
+        resolver = make_unique<HostResolver>(min(max(options.jobs, 1), maxResolverThreads), options.ipv6);
+        resolver->setNotifier([this] { curl_multi_wakeup(multi); });
+    }
+
+    //New links wake up curl_multi_poll() so they're started right away
+    queue.setNotifier([this] { curl_multi_wakeup(multi); });
+
+    //URLs taken from the queue but still waiting for their host, a few per
+    //handle is enough to keep every host busy without emptying the queue
+    const size_t maxWaiting = transfers.size() * 16;
+
+    const auto idleLoop = [this] { return active == 0 && scheduler.empty() && parked == 0; };
+
+    int running = 0;
+    vector<HostResolver::Answer> answers;
+    while (true) {
+        //Take what the extraction has found so far, and only
+        //wait for it when there's nothing else to do
+        while (scheduler.waiting() + parked < maxWaiting) {
+            FoundLink link;
+            const bool got = idleLoop() ? queue.pop(link) : queue.tryPop(link);
+            if (!got) break;
+            accept(move(link));
+        }
+
+        if (resolver) {
+            resolver->collect(answers);
+            resolved(answers);
+        }
+
+        skipUnreachable();
+        startWaiting();
+        if (idleLoop()) break; //Queue is closed and empty
+
+        if (curl_multi_perform(multi, &running) != CURLM_OK) {
+            reportProblem(options, callbacks, "Requests engine failure.\n", error);
+            break;
+        }
+
+        int left = 0;
+        while (CURLMsg *msg = curl_multi_info_read(multi, &left)) {
+            if (msg->msg != CURLMSG_DONE) continue;
+
+            Transfer *transfer = nullptr;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &transfer);
+            finish(transfer, msg->data.result);
+        }
+        skipUnreachable();
+
+        //Throttled hosts decide how long we can sleep
+        const long wait = scheduler.empty() || idle.empty() ? 1000 : scheduler.msUntilNext(1000);
+        if (running > 0 || !scheduler.empty() || parked > 0) curl_multi_poll(multi, nullptr, 0, wait, nullptr);
+    }
+
+    if (verbose && !lookups.empty()) {
+        const auto missing = count_if(lookups.begin(), lookups.end(), [](const auto &lookup) {
+            return lookup.second.status == HostResolver::Answer::NotFound;
+        });
+        cout << "Resolved " << lookups.size() << " host(s) ahead of their requests, " << missing << " of them don't exist.\n";
+    }
+    for (const auto &tripped: scheduler.trippedHosts())
+        reportProblem(options, callbacks, "Host \"" + tripped.host + "\" was unreachable, " + to_string(tripped.skipped) + " of its URL(s) weren't requested.\n", warn);
+    if (verbose || (options.console && index.occurrences() > index.uniqueURLs()))
+        cout << index.uniqueURLs() << " unique URL(s) found at " << index.occurrences() << " location(s).\n";
+    if (((options.showTimings && options.console) || verbose) && !metrics.empty()) metrics.printSummary(maxSlowHosts);
+    if (!options.metricsPath.empty() && !metrics.write(options.metricsPath))
+        reportProblem(options, callbacks, "Failed to write the metrics \"" + options.metricsPath + "\".\n", error);
+    if (report && !report->close())
+        reportProblem(options, callbacks, "Failed to write the whole report \"" + options.reportPath + "\".\n", error);
+
+    queue.setNotifier(nullptr);
+    discard();
+
+    summary.URLs      = checked;
+    summary.links     = links;
+    summary.deadLinks = deadLinks;
+}
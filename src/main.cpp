@@ -16,70 +16,36 @@
 #include <iostream>
 #include <filesystem>
 #include <string>
+#include <cstring>
 #include <algorithm>
+#include <csignal>
 
+#include <fud.h>
 #include <checker.h>
+#include <walker.h>
+#include <watcher.h>
 #include <colors.h>
 #include <versions.h>
 
 using namespace std;
 namespace fs = filesystem;
 
-//Global vars
-
-int    timeout          = 30;    //sec
-bool   ipv6             = false; //Forces IPv6
-bool   followRedirects  = true;  //Follow HTTP redirects?
-long   maxRedirects     = -1;    //-1 = infinite | 0 = no redirects.
-bool   useProxy         = false; //Use proxy?
-string proxy;                    //http:// https:// socks4:// socks4a:// socks5:// socks5h://
-bool   duplicateCheck   = false; //If true then duplicate URLs will be checked
-bool   verbose          = false;
-
-/*
-Used by checkURLs() in checker.cpp
-to enable or disable request redirects protocols
-
-By default libcurl will allow HTTP, HTTPS, FTP and FTPS on redirect (7.65.2).
-Older versions of libcurl allowed all protocols on redirect except several disabled
-for security reasons: Since 7.19.4 FILE and SCP are disabled,
-and since 7.40.0 SMB and SMBS are also disabled.
-CURLPROTO_ALL enables all protocols on redirect, including those disabled for security.
-*/
-bool CURL_REDIRECT_PROTOCOL_ALL    = true;
-bool CURL_REDIRECT_PROTOCOL_DICT   = false;
-bool CURL_REDIRECT_PROTOCOL_FILE   = false;
-bool CURL_REDIRECT_PROTOCOL_FTP    = false;
-bool CURL_REDIRECT_PROTOCOL_FTPS   = false;
-bool CURL_REDIRECT_PROTOCOL_GOPHER = false;
-bool CURL_REDIRECT_PROTOCOL_HTTP   = false;
-bool CURL_REDIRECT_PROTOCOL_HTTPS  = false;
-bool CURL_REDIRECT_PROTOCOL_IMAP   = false;
-bool CURL_REDIRECT_PROTOCOL_IMAPS  = false;
-bool CURL_REDIRECT_PROTOCOL_LDAP   = false;
-bool CURL_REDIRECT_PROTOCOL_LDAPS  = false;
-bool CURL_REDIRECT_PROTOCOL_POP3   = false;
-bool CURL_REDIRECT_PROTOCOL_POP3S  = false;
-bool CURL_REDIRECT_PROTOCOL_RTMP   = false;
-bool CURL_REDIRECT_PROTOCOL_RTMPE  = false;
-bool CURL_REDIRECT_PROTOCOL_RTMPS  = false;
-bool CURL_REDIRECT_PROTOCOL_RTMPT  = false;
-bool CURL_REDIRECT_PROTOCOL_RTMPTE = false;
-bool CURL_REDIRECT_PROTOCOL_RTMPTS = false;
-bool CURL_REDIRECT_PROTOCOL_RTSP   = false;
-bool CURL_REDIRECT_PROTOCOL_SCP    = false;
-bool CURL_REDIRECT_PROTOCOL_SFTP   = false;
-bool CURL_REDIRECT_PROTOCOL_SMB    = false;
-bool CURL_REDIRECT_PROTOCOL_SMBS   = false;
-bool CURL_REDIRECT_PROTOCOL_SMTP   = false;
-bool CURL_REDIRECT_PROTOCOL_SMTPS  = false;
-bool CURL_REDIRECT_PROTOCOL_TELNET = false;
-bool CURL_REDIRECT_PROTOCOL_TFTP   = false;
-
-
 //Non-Global vars
+ScanOptions options; //Everything the scanner is told by the arguments
 bool recursiveSearch = false;
-bool ANSI            = true;
+bool watchMode = false;  //--watch
+WalkOptions walkOptions; //--include, --exclude and --gitignore
+Watcher *watching = nullptr;
+
+//Messages of the command line, colored like the ones of the scans
+static void dye(const string &msg, Color color) { dye(msg, color, options.ansi); }
+
+//Ctrl+C ends --watch once the scan going on is done, a second one right away
+void stopWatching(int)
+{
+    signal(SIGINT, SIG_DFL);
+    if (watching) watching->stop();
+}
 
 
 void displayHelp()
@@ -92,7 +58,34 @@ void displayHelp()
             "\t|       Argument       |         Value       |Default|              Description           |\n"
             "\t =========================================================================================\n"
             "\t| --timeout            | Number              |  30   | Time in seconds before timeout     |\n"
+            "\t| --connect-timeout    | Number              |  10   | Seconds allowed to connect         |\n"
+            "\t| --low-speed-time     | Number              |   0   | Seconds under low speed to give up |\n"
+            "\t| --low-speed-limit    | Number              |   1   | Low speed in bytes per second      |\n"
+            "\t| --adaptive-timeout   | true, false         | false | Per host deadlines from latencies  |\n"
+            "\t| --jobs               | Number              |  16   | Maximum simultaneous requests      |\n"
+            "\t| --per-host           | Number              |   4   | Simultaneous requests per host     |\n"
+            "\t| --per-host-rate      | Number              |   0   | Requests per second per host       |\n"
+            "\t| --breaker            | Number              |   3   | Failures in a row to skip a host   |\n"
+            "\t| --breaker-probe      | true, false         | true  | One last try before skipping host  |\n"
+            "\t| --threads            | Number              | auto  | Threads used to read files         |\n"
+            "\t| --method             | head, get           | head  | HEAD (GET if rejected) or GET only |\n"
+            "\t| --cache              | Path                | NULL  | Keep results between runs in file  |\n"
+            "\t| --cache-ttl          | Number              | 3600  | Seconds a cached result is fresh   |\n"
+            "\t| --incremental        | Path                | NULL  | Only rescan files changed since    |\n"
+            "\t|                      |                     |       | the run that wrote this manifest   |\n"
+            "\t| --max-file-size      | Number (K, M, G)    | 256M  | Skip files bigger than this        |\n"
+            "\t| --local-links        | true, false         | true  | Check relative links and anchors   |\n"
+            "\t|                      |                     |       | of .html/.md files on the disk     |\n"
+            "\t| --format             | jsonl, csv, sarif   | NULL  | Report of every link found, also   |\n"
+            "\t|                      |                     |       | jsonl when --output is given       |\n"
+            "\t| --output             | Path                |   -   | Where the report is written        |\n"
+            "\t| --timings            | true, false         | false | Request timings table at the end   |\n"
+            "\t| --metrics            | Path                | NULL  | Timings as Prometheus text or JSON |\n"
             "\t| --recursive          |                     |       | Scan directories recursively       |\n"
+            "\t| --watch              |                     |       | Scan again the files that change   |\n"
+            "\t| --include            | Globs (a,b,...)     | NULL  | Only read the files matching these |\n"
+            "\t| --exclude            | Globs (a,b,...)     | NULL  | Skip matching files and dirs       |\n"
+            "\t| --gitignore          | true, false         | false | Skip what .gitignore files ignore  |\n"
             "\t| --ipv6               | true, false         | false | Enables IPv6 instead of IPv4       |\n"
             "\t| --followredirects    | true, false         | true  | Follow URL redirections?           |\n"
             "\t| --maxredirects       | Number              |  -1   | Redirections limit (-1 = infinite) |\n"
@@ -109,7 +102,7 @@ void displayHelp()
             "\t|                      |                     |       |                                    |\n"
             "\t| --ansi               | true, false         | auto  | Enables ANSI escape sequences      |\n"
             "\t| --verbose            |                     |       | Enables verbose mode               |\n"
-            "\t| --duplicatecheck     |                     |       | Check all URLs. even duplicates    |\n"
+            "\t| --duplicatecheck     |                     |       | Check near-duplicate URLs apart    |\n"
             "\t|                      |                     |       |                                    |\n"
             "\t| --proxy              | SCHEME://PROXY:PORT | NULL  | Use proxy to make requests, if no  |\n"
             "\t|                      | Schemes:            |       | port is provided then 1080 will be |\n"
@@ -124,30 +117,29 @@ void displayHelp()
     dye("\t" + Libraries::libcurlVersion + "\n", dim);
 }
 
-//Takes a directory path and returns the number of
-//files in it, This used to show a warning if the folder is large.
-size_t number_of_files_in_directory(fs::path path, bool recursive)
+//Takes a comma separated list of globs, "what" is used in error messages
+bool parse_globs(const string &list, const string &what, vector<GlobRule> &rules)
 {
-    using fp = bool (*)(const fs::path&);
-    if (recursive) {
-        using fs::recursive_directory_iterator;
-        return count_if(recursive_directory_iterator(path), {}, (fp)fs::is_regular_file);
+    size_t begin = 0;
+    while (begin <= list.size()) {
+        const size_t end = min(list.find(',', begin), list.size());
+        GlobRule rule;
+        if (GlobRule::parse(list.substr(begin, end - begin), false, rule)) rules.push_back(rule);
+        else if (end > begin) {
+            dye(what + " pattern is invalid: " + list.substr(begin, end - begin) + "\n", error);
+            return false;
+        }
+        begin = end + 1;
     }
-    else {
-        using fs::directory_iterator;
-        return count_if(directory_iterator(path), {}, (fp)fs::is_regular_file);
+    if (rules.empty()) {
+        dye(what + " pattern is empty.\n", error);
+        return false;
     }
+    return true;
 }
 
 int main(int argc, char *argv[])
 {
-    //Enable ANSI escape sequences if not running on Windows
-    #ifndef WIN32
-        ANSI = true;
-    #else
-        ANSI = false;
-    #endif
-
     if (argc == 1 ||
         (argc == 2 && strcmp(argv[1], "--help") == 0) ||
         (argc == 2 && strcmp(argv[1], "--version") == 0)) {
@@ -155,6 +147,10 @@ int main(int argc, char *argv[])
         return 0;
     }
     else {
+        //--redirectsprotocols, CURLPROTO_* flags unless "all" is given
+        bool allProtocols = true;
+        long redirectProtocols = 0;
+
         vector<string> nonArgs;
         for (int a = 1; a < argc; a++) {
             const string arg_str(argv[a]);
@@ -162,6 +158,25 @@ int main(int argc, char *argv[])
             if (arg_str.find("--recursive") != string::npos) {
                 recursiveSearch = true;
             }
+            else if (arg_str.find("--watch") != string::npos) {
+                watchMode = true;
+            }
+            else if (arg_str.find("--include=") != string::npos) {
+                if (!parse_globs(arg_str.substr(10), "Include", walkOptions.include)) return -1;
+            }
+            else if (arg_str.find("--exclude=") != string::npos) {
+                if (!parse_globs(arg_str.substr(10), "Exclude", walkOptions.exclude)) return -1;
+            }
+            else if (arg_str.find("--gitignore=") != string::npos) {
+                string arg_gi(arg_str.substr(12));
+                for (auto &c: arg_gi) { c = tolower(c); }
+                if (arg_gi == "true" || arg_gi == "false")
+                    walkOptions.gitignore = arg_gi == "true";
+                else {
+                    dye("Unknown Gitignore argument value." + arg_gi + "\n", error);
+                    return -1;
+                }
+            }
             else if (arg_str.find("--timeout=") != string::npos) {
                 try {
                     size_t pos;
@@ -174,7 +189,7 @@ int main(int argc, char *argv[])
                         dye("Timeout number cannot be negative: " + to_string(t) + "\n", error);
                         return -1;
                     }
-                    timeout = t;
+                    options.timeout = t;
                 }
                 catch (invalid_argument const &ex) {
                     dye("Timeout invalid number: " + arg_str + "\n", error);
@@ -185,13 +200,344 @@ int main(int argc, char *argv[])
                     return -1;
                 }
             }
+            else if (arg_str.find("--connect-timeout=") != string::npos) {
+                try {
+                    size_t pos;
+                    const long v = stol(arg_str.substr(18), &pos);
+                    if (pos < arg_str.substr(18).size()) {
+                        dye("Trailing characters after Connect Timeout number: " + to_string(v) + "\n", error);
+                        return -1;
+                    }
+                    if (v < 0 || v > 86400) {
+                        dye("Connect Timeout number must be between 0 and 86400: " + to_string(v) + "\n", error);
+                        return -1;
+                    }
+                    options.connectTimeout = v;
+                }
+                catch (invalid_argument const &ex) {
+                    dye("Connect Timeout invalid number: " + arg_str + "\n", error);
+                    return -1;
+                }
+                catch (out_of_range const &ex) {
+                    dye("Connect Timeout number out of range: " + arg_str + "\n", error);
+                    return -1;
+                }
+            }
+            else if (arg_str.find("--low-speed-time=") != string::npos) {
+                try {
+                    size_t pos;
+                    const long v = stol(arg_str.substr(17), &pos);
+                    if (pos < arg_str.substr(17).size()) {
+                        dye("Trailing characters after Low Speed Time number: " + to_string(v) + "\n", error);
+                        return -1;
+                    }
+                    if (v < 0 || v > 86400) {
+                        dye("Low Speed Time number must be between 0 (disabled) and 86400: " + to_string(v) + "\n", error);
+                        return -1;
+                    }
+                    options.lowSpeedTime = v;
+                }
+                catch (invalid_argument const &ex) {
+                    dye("Low Speed Time invalid number: " + arg_str + "\n", error);
+                    return -1;
+                }
+                catch (out_of_range const &ex) {
+                    dye("Low Speed Time number out of range: " + arg_str + "\n", error);
+                    return -1;
+                }
+            }
+            else if (arg_str.find("--low-speed-limit=") != string::npos) {
+                try {
+                    size_t pos;
+                    const long v = stol(arg_str.substr(18), &pos);
+                    if (pos < arg_str.substr(18).size()) {
+                        dye("Trailing characters after Low Speed Limit number: " + to_string(v) + "\n", error);
+                        return -1;
+                    }
+                    if (v < 1 || v > 1L << 30) {
+                        dye("Low Speed Limit number must be between 1 and 1073741824: " + to_string(v) + "\n", error);
+                        return -1;
+                    }
+                    options.lowSpeedLimit = v;
+                }
+                catch (invalid_argument const &ex) {
+                    dye("Low Speed Limit invalid number: " + arg_str + "\n", error);
+                    return -1;
+                }
+                catch (out_of_range const &ex) {
+                    dye("Low Speed Limit number out of range: " + arg_str + "\n", error);
+                    return -1;
+                }
+            }
+            else if (arg_str.find("--adaptive-timeout=") != string::npos) {
+                string arg_at(arg_str.substr(19));
+                for (auto &c: arg_at) { c = tolower(c); }
+                if (arg_at == "true" || arg_at == "false")
+                    options.adaptiveTimeout = arg_at == "true";
+                else {
+                    dye("Unknown Adaptive Timeout argument value." + arg_at + "\n", error);
+                    return -1;
+                }
+            }
+            else if (arg_str.find("--jobs=") != string::npos) {
+                try {
+                    size_t pos;
+                    const long j = stol(arg_str.substr(7), &pos);
+                    if (pos < arg_str.substr(7).size()) {
+                        dye("Trailing characters after Jobs number: " + to_string(j) + "\n", error);
+                        return -1;
+                    }
+                    if (j < 1 || j > 1024) {
+                        dye("Jobs number must be between 1 and 1024: " + to_string(j) + "\n", error);
+                        return -1;
+                    }
+                    options.jobs = j;
+                }
+                catch (invalid_argument const &ex) {
+                    dye("Jobs invalid number: " + arg_str + "\n", error);
+                    return -1;
+                }
+                catch (out_of_range const &ex) {
+                    dye("Jobs number out of range: " + arg_str + "\n", error);
+                    return -1;
+                }
+            }
+            else if (arg_str.find("--per-host=") != string::npos) {
+                try {
+                    size_t pos;
+                    const long h = stol(arg_str.substr(11), &pos);
+                    if (pos < arg_str.substr(11).size()) {
+                        dye("Trailing characters after Per Host number: " + to_string(h) + "\n", error);
+                        return -1;
+                    }
+                    if (h < 1 || h > 1024) {
+                        dye("Per Host number must be between 1 and 1024: " + to_string(h) + "\n", error);
+                        return -1;
+                    }
+                    options.perHost = h;
+                }
+                catch (invalid_argument const &ex) {
+                    dye("Per Host invalid number: " + arg_str + "\n", error);
+                    return -1;
+                }
+                catch (out_of_range const &ex) {
+                    dye("Per Host number out of range: " + arg_str + "\n", error);
+                    return -1;
+                }
+            }
+            else if (arg_str.find("--per-host-rate=") != string::npos) {
+                try {
+                    size_t pos;
+                    const double r = stod(arg_str.substr(16), &pos);
+                    if (pos < arg_str.substr(16).size()) {
+                        dye("Trailing characters after Per Host Rate number: " + arg_str + "\n", error);
+                        return -1;
+                    }
+                    if (!(r >= 0 && r <= 1000000)) {
+                        dye("Per Host Rate must be between 0 (no limit) and 1000000: " + arg_str + "\n", error);
+                        return -1;
+                    }
+                    options.perHostRate = r;
+                }
+                catch (invalid_argument const &ex) {
+                    dye("Per Host Rate invalid number: " + arg_str + "\n", error);
+                    return -1;
+                }
+                catch (out_of_range const &ex) {
+                    dye("Per Host Rate number out of range: " + arg_str + "\n", error);
+                    return -1;
+                }
+            }
+            else if (arg_str.find("--breaker=") != string::npos) {
+                try {
+                    size_t pos;
+                    const long b = stol(arg_str.substr(10), &pos);
+                    if (pos < arg_str.substr(10).size()) {
+                        dye("Trailing characters after Breaker number: " + to_string(b) + "\n", error);
+                        return -1;
+                    }
+                    if (b < 0 || b > 1000000) {
+                        dye("Breaker number must be between 0 (never) and 1000000: " + to_string(b) + "\n", error);
+                        return -1;
+                    }
+                    options.breakerThreshold = b;
+                }
+                catch (invalid_argument const &ex) {
+                    dye("Breaker invalid number: " + arg_str + "\n", error);
+                    return -1;
+                }
+                catch (out_of_range const &ex) {
+                    dye("Breaker number out of range: " + arg_str + "\n", error);
+                    return -1;
+                }
+            }
+            else if (arg_str.find("--breaker-probe=") != string::npos) {
+                string arg_bp(arg_str.substr(16));
+                for (auto &c: arg_bp) { c = tolower(c); }
+                if (arg_bp == "true" || arg_bp == "false")
+                    options.breakerProbe = arg_bp == "true";
+                else {
+                    dye("Unknown Breaker Probe argument value." + arg_bp + "\n", error);
+                    return -1;
+                }
+            }
+            else if (arg_str.find("--threads=") != string::npos) {
+                try {
+                    size_t pos;
+                    const long t = stol(arg_str.substr(10), &pos);
+                    if (pos < arg_str.substr(10).size()) {
+                        dye("Trailing characters after Threads number: " + to_string(t) + "\n", error);
+                        return -1;
+                    }
+                    if (t < 0 || t > 1024) {
+                        dye("Threads number must be between 0 (auto) and 1024: " + to_string(t) + "\n", error);
+                        return -1;
+                    }
+                    options.threads = t;
+                }
+                catch (invalid_argument const &ex) {
+                    dye("Threads invalid number: " + arg_str + "\n", error);
+                    return -1;
+                }
+                catch (out_of_range const &ex) {
+                    dye("Threads number out of range: " + arg_str + "\n", error);
+                    return -1;
+                }
+            }
+            else if (arg_str.find("--method=") != string::npos) {
+                string arg_method(arg_str.substr(9));
+                for (auto &c: arg_method) { c = tolower(c); }
+                if (arg_method == "head" || arg_method == "get")
+                    options.headRequests = arg_method == "head";
+                else {
+                    dye("Unknown Method argument value." + arg_method + "\n", error);
+                    return -1;
+                }
+            }
+            else if (arg_str.find("--cache=") != string::npos) {
+                options.cachePath = arg_str.substr(8);
+                if (options.cachePath.empty()) {
+                    dye("Cache path is empty.\n", error);
+                    return -1;
+                }
+            }
+            else if (arg_str.find("--max-file-size=") != string::npos) {
+                try {
+                    size_t pos;
+                    const string arg_size(arg_str.substr(16));
+                    const long long m = stoll(arg_size, &pos);
+                    int shift = 0;
+                    if (pos + 1 == arg_size.size()) {
+                        switch (tolower(arg_size[pos])) {
+                            case 'k': shift = 10; break;
+                            case 'm': shift = 20; break;
+                            case 'g': shift = 30; break;
+                            default:  shift = -1;
+                        }
+                        pos++;
+                    }
+                    if (pos < arg_size.size() || shift < 0) {
+                        dye("Trailing characters after Max File Size number: " + arg_size + "\n", error);
+                        return -1;
+                    }
+                    if (m < 0 || m > (1LL << 40) >> shift) {
+                        dye("Max File Size must be between 0 (no limit) and 1T: " + arg_size + "\n", error);
+                        return -1;
+                    }
+                    options.maxFileSize = (uintmax_t)m << shift;
+                }
+                catch (invalid_argument const &ex) {
+                    dye("Max File Size invalid number: " + arg_str + "\n", error);
+                    return -1;
+                }
+                catch (out_of_range const &ex) {
+                    dye("Max File Size number out of range: " + arg_str + "\n", error);
+                    return -1;
+                }
+            }
+            else if (arg_str.find("--local-links=") != string::npos) {
+                string arg_ll(arg_str.substr(14));
+                for (auto &c: arg_ll) { c = tolower(c); }
+                if (arg_ll == "true" || arg_ll == "false")
+                    options.localLinks = arg_ll == "true";
+                else {
+                    dye("Unknown Local Links argument value." + arg_ll + "\n", error);
+                    return -1;
+                }
+            }
+            else if (arg_str.find("--incremental=") != string::npos) {
+                options.manifestPath = arg_str.substr(14);
+                if (options.manifestPath.empty()) {
+                    dye("Manifest path is empty.\n", error);
+                    return -1;
+                }
+            }
+            else if (arg_str.find("--format=") != string::npos) {
+                string arg_format(arg_str.substr(9));
+                for (auto &c: arg_format) { c = tolower(c); }
+                ReportWriter::Format format;
+                if (ReportWriter::parseFormat(arg_format, format))
+                    options.reportFormat = arg_format;
+                else {
+                    dye("Unknown Format argument value." + arg_format + "\n", error);
+                    return -1;
+                }
+            }
+            else if (arg_str.find("--output=") != string::npos) {
+                options.reportPath = arg_str.substr(9);
+                if (options.reportPath.empty()) {
+                    dye("Output path is empty.\n", error);
+                    return -1;
+                }
+                if (options.reportFormat.empty()) options.reportFormat = "jsonl";
+            }
+            else if (arg_str.find("--timings=") != string::npos) {
+                string arg_timings(arg_str.substr(10));
+                for (auto &c: arg_timings) { c = tolower(c); }
+                if (arg_timings == "true" || arg_timings == "false")
+                    options.showTimings = arg_timings == "true";
+                else {
+                    dye("Unknown Timings argument value." + arg_timings + "\n", error);
+                    return -1;
+                }
+            }
+            else if (arg_str.find("--metrics=") != string::npos) {
+                options.metricsPath = arg_str.substr(10);
+                if (options.metricsPath.empty()) {
+                    dye("Metrics path is empty.\n", error);
+                    return -1;
+                }
+            }
+            else if (arg_str.find("--cache-ttl=") != string::npos) {
+                try {
+                    size_t pos;
+                    const long t = stol(arg_str.substr(12), &pos);
+                    if (pos < arg_str.substr(12).size()) {
+                        dye("Trailing characters after Cache TTL number: " + to_string(t) + "\n", error);
+                        return -1;
+                    }
+                    if (t < 0) {
+                        dye("Cache TTL number cannot be negative: " + to_string(t) + "\n", error);
+                        return -1;
+                    }
+                    options.cacheTTL = t;
+                }
+                catch (invalid_argument const &ex) {
+                    dye("Cache TTL invalid number: " + arg_str + "\n", error);
+                    return -1;
+                }
+                catch (out_of_range const &ex) {
+                    dye("Cache TTL number out of range: " + arg_str + "\n", error);
+                    return -1;
+                }
+            }
             else if (arg_str.find("--ipv6=") != string::npos) {
                 string arg_ipv6(arg_str.substr(7));
                 for (auto &c: arg_ipv6) { c = tolower(c); }
                 try {
                     if ((arg_ipv6.length() == 4 && arg_ipv6.find("true") != string::npos) ||
                         (arg_ipv6.length() == 5 && arg_ipv6.find("false") != string::npos))
-                        ipv6 = arg_ipv6 == "true" ? true : false;
+                        options.ipv6 = arg_ipv6 == "true" ? true : false;
                     else {
                         dye("Unknown IPv6 argument value." + arg_ipv6 + "\n", error);
                         return -1;
@@ -207,7 +553,7 @@ int main(int argc, char *argv[])
                 try {
                     if ((arg_fr.length() == 4 && arg_fr.find("true") != string::npos) ||
                         (arg_fr.length() == 5 && arg_fr.find("false") != string::npos))
-                        ipv6 = arg_fr == "true" ? true : false;
+                        options.followRedirects = arg_fr == "true" ? true : false;
                     else {
                         dye("Unknown Follow Redirects argument value." + arg_fr + "\n", error);
                         return -1;
@@ -229,7 +575,7 @@ int main(int argc, char *argv[])
                         dye("Maximum Redirects number cannot be lower than \"-1\": " + to_string(m) + "\n", error);
                         return -1;
                     }
-                    maxRedirects = m;
+                    options.maxRedirects = m;
                 }
                 catch (invalid_argument const &ex) {
                     dye("Maximum Redirects invalid number: " + arg_str + "\n", error);
@@ -255,44 +601,27 @@ int main(int argc, char *argv[])
                     }
                     while (0 != *str++);
                     if (protocols.size() > 0) { //Making sure there's protocols
+                        const pair<const char*, long> known[] = {
+                            {"http", CURLPROTO_HTTP}, {"https", CURLPROTO_HTTPS}, {"ftp", CURLPROTO_FTP}, {"ftps", CURLPROTO_FTPS},
+                            {"file", CURLPROTO_FILE}, {"gopher", CURLPROTO_GOPHER}, {"imap", CURLPROTO_IMAP}, {"imaps", CURLPROTO_IMAPS},
+                            {"ldap", CURLPROTO_LDAP}, {"ldaps", CURLPROTO_LDAPS}, {"pop3", CURLPROTO_POP3}, {"pop3s", CURLPROTO_POP3S},
+                            {"rtmp", CURLPROTO_RTMP}, {"rtmpe", CURLPROTO_RTMPE}, {"rtmps", CURLPROTO_RTMPS}, {"rtmpt", CURLPROTO_RTMPT},
+                            {"rtmpte", CURLPROTO_RTMPTE}, {"rtmpts", CURLPROTO_RTMPTS}, {"rtsp", CURLPROTO_RTSP}, {"scp", CURLPROTO_SCP},
+                            {"sftp", CURLPROTO_SFTP}, {"smb", CURLPROTO_SMB}, {"smbs", CURLPROTO_SMBS}, {"smtp", CURLPROTO_SMTP},
+                            {"smtps", CURLPROTO_SMTPS}, {"telnet", CURLPROTO_TELNET}, {"tftp", CURLPROTO_TFTP}, {"dict", CURLPROTO_DICT}
+                        };
                         for(const string &protocol: protocols) {
 
                             //If "all" is provided as a value then break the loop and do something else
                             //There's no reason to check the rest because they all should be enabled which "all" do.
                             if (protocol.find("all") != string::npos) {
-                                CURL_REDIRECT_PROTOCOL_ALL = true; //Use all protocols
+                                allProtocols = true; //Use all protocols
                                 break; //break the loop
                             }
                             else {
-                                CURL_REDIRECT_PROTOCOL_ALL = false; //"All" must be disabled in order to customize protocols
-                                if (protocol.find("http") != string::npos) CURL_REDIRECT_PROTOCOL_HTTP = true;
-                                if (protocol.find("https") != string::npos) CURL_REDIRECT_PROTOCOL_HTTPS = true;
-                                if (protocol.find("ftp") != string::npos) CURL_REDIRECT_PROTOCOL_FTP = true;
-                                if (protocol.find("ftps") != string::npos) CURL_REDIRECT_PROTOCOL_FTPS = true;
-                                if (protocol.find("file") != string::npos) CURL_REDIRECT_PROTOCOL_FILE = true;
-                                if (protocol.find("gopher") != string::npos) CURL_REDIRECT_PROTOCOL_GOPHER = true;
-                                if (protocol.find("imap") != string::npos) CURL_REDIRECT_PROTOCOL_IMAP = true;
-                                if (protocol.find("imaps") != string::npos) CURL_REDIRECT_PROTOCOL_IMAPS = true;
-                                if (protocol.find("ldap") != string::npos) CURL_REDIRECT_PROTOCOL_LDAP = true;
-                                if (protocol.find("ldaps") != string::npos) CURL_REDIRECT_PROTOCOL_LDAPS = true;
-                                if (protocol.find("pop3") != string::npos) CURL_REDIRECT_PROTOCOL_POP3 = true;
-                                if (protocol.find("pop3s") != string::npos) CURL_REDIRECT_PROTOCOL_POP3S = true;
-                                if (protocol.find("rtmp") != string::npos) CURL_REDIRECT_PROTOCOL_RTMP = true;
-                                if (protocol.find("rtmpe") != string::npos) CURL_REDIRECT_PROTOCOL_RTMPE = true;
-                                if (protocol.find("rtmps") != string::npos) CURL_REDIRECT_PROTOCOL_RTMPS = true;
-                                if (protocol.find("rtmpt") != string::npos) CURL_REDIRECT_PROTOCOL_RTMPT = true;
-                                if (protocol.find("rtmpte") != string::npos) CURL_REDIRECT_PROTOCOL_RTMPTE = true;
-                                if (protocol.find("rtmpts") != string::npos) CURL_REDIRECT_PROTOCOL_RTMPTS = true;
-                                if (protocol.find("rtsp") != string::npos) CURL_REDIRECT_PROTOCOL_RTSP = true;
-                                if (protocol.find("scp") != string::npos) CURL_REDIRECT_PROTOCOL_SCP = true;
-                                if (protocol.find("sftp") != string::npos) CURL_REDIRECT_PROTOCOL_SFTP = true;
-                                if (protocol.find("smb") != string::npos) CURL_REDIRECT_PROTOCOL_SMB = true;
-                                if (protocol.find("smbs") != string::npos) CURL_REDIRECT_PROTOCOL_SMBS = true;
-                                if (protocol.find("smtp") != string::npos) CURL_REDIRECT_PROTOCOL_SMTP = true;
-                                if (protocol.find("smtps") != string::npos) CURL_REDIRECT_PROTOCOL_SMTPS = true;
-                                if (protocol.find("telnet") != string::npos) CURL_REDIRECT_PROTOCOL_TELNET = true;
-                                if (protocol.find("tftp") != string::npos) CURL_REDIRECT_PROTOCOL_TFTP = true;
-                                if (protocol.find("dict") != string::npos) CURL_REDIRECT_PROTOCOL_DICT = true;
+                                allProtocols = false; //"All" must be disabled in order to customize protocols
+                                for (const auto &p: known)
+                                    if (protocol.find(p.first) != string::npos) redirectProtocols |= p.second;
                             }
                         }
                     }
@@ -314,7 +643,7 @@ int main(int argc, char *argv[])
                 try {
                     if ((arg_ansi.length() == 4 && arg_ansi.find("true") != string::npos) ||
                         (arg_ansi.length() == 5 && arg_ansi.find("false") != string::npos))
-                        ANSI = arg_ansi == "true" ? true : false;
+                        options.ansi = arg_ansi == "true" ? true : false;
                     else {
                         dye("Unknown ANSI argument value." + arg_ansi + "\n", error);
                         return -1;
@@ -325,16 +654,16 @@ int main(int argc, char *argv[])
                 }
             }
             else if (arg_str.find("--verbose") != string::npos) {
-                verbose = true;
+                options.verbose = true;
             }
             else if (arg_str.find("--duplicatecheck") != string::npos) {
-                duplicateCheck = true;
+                options.duplicateCheck = true;
             }
             else if (arg_str.find("--proxy=") != string::npos) {
                 const string arg_proxy(arg_str.substr(8));
                 try {
-                    useProxy = true;
-                    proxy = arg_proxy;
+                    options.useProxy = true;
+                    options.proxy = arg_proxy;
                 }
                 catch (invalid_argument const &ex) {
                     dye("Proxy invalid argument: " + arg_str + "\n", error);
@@ -343,14 +672,27 @@ int main(int argc, char *argv[])
             else { nonArgs.push_back(arg_str); }
         }
 
+        options.redirectProtocols = allProtocols ? CURLPROTO_ALL : redirectProtocols;
+
+        //The report owns the standard output, everything else is shown on the error output
+        if (!options.reportFormat.empty() && ReportWriter::toStandardOutput(options.reportPath)) cout.rdbuf(cerr.rdbuf());
+
         if (nonArgs.size() > 0) {
-            vector<string> paths;
+            vector<string> paths, directories;
             for (const auto &path: nonArgs) { //Loop through files/dirs
 
                 if (fs::is_directory(path)) { //Checks if path is directory
+                    directories.push_back(path);
+
+                    //One pass over the directory, the files found are only kept if the user agrees
+                    vector<string> dir_files, dir_errors;
+                    walkOptions.recursive = recursiveSearch;
+                    walkOptions.threads   = options.threads > 0 ? options.threads : ThreadPool::defaultThreads();
+                    DirectoryWalker(walkOptions).walk(path, dir_files, dir_errors);
+                    for (const auto &err: dir_errors) dye(err + "\n", warn);
 
                     //Warn if directory is big
-                    const size_t dir_size = number_of_files_in_directory(path, recursiveSearch);
+                    const size_t dir_size = dir_files.size();
                     if (dir_size > 1000) {
                         string dir_size_answer;
                         ask_about_dir:
@@ -371,16 +713,7 @@ int main(int argc, char *argv[])
                         }
                     }
 
-                    if (recursiveSearch) {
-                        for (const auto &p: fs::recursive_directory_iterator(path)) {
-                            if (fs::is_regular_file(p)) paths.push_back(p.path().string());
-                        }
-                    }
-                    else {
-                        for (const auto &p: fs::directory_iterator(path)) {
-                            if (fs::is_regular_file(p)) paths.push_back(p.path().string());
-                        }
-                    }
+                    paths.insert(paths.end(), make_move_iterator(dir_files.begin()), make_move_iterator(dir_files.end()));
                 }
                 else { //Path is not a directory
                     if (fs::is_regular_file(path)) { //Path is a regular file
@@ -391,15 +724,31 @@ int main(int argc, char *argv[])
                     }
                 }
             }
-            if (paths.size() > 0) {
-                try {
-                    cout << "initializing the checker...\n";
-                    Checker checker(paths);
-                    cout << "Starting...\n";
-                    checker.checkURLs(checker.extractURLS());
-                }
-                catch (int err_code) {
-                    dye(Product::shortName + " error code: " + to_string(err_code) + "\n", error);
+            //Unchanged files give their URLs back, the results need a cache too
+            if (!options.manifestPath.empty() && options.cachePath.empty()) options.cachePath = options.manifestPath + ".cache";
+
+            //Our own files may live among the scanned ones
+            paths.erase(remove_if(paths.begin(), paths.end(), [](const string &p) {
+                error_code failed;
+                for (const string &own: {options.manifestPath, options.cachePath, options.reportPath, options.metricsPath})
+                    if (!own.empty() && fs::equivalent(p, own, failed)) return true;
+                return false;
+            }), paths.end());
+
+            if (paths.size() > 0 && watchMode) {
+                Watcher watcher(options, walkOptions);
+                watching = &watcher;
+                signal(SIGINT, stopWatching);
+                const bool watched = watcher.watch(paths, directories);
+                watching = nullptr;
+                if (!watched) return -1;
+            }
+            else if (paths.size() > 0) {
+                cout << "initializing the checker...\n";
+                Scanner scanner(options);
+                cout << "Starting...\n";
+                if (scanner.scan(paths).URLs < 1) {
+                    dye(Product::shortName + " error code: 2\n", error);
                     return -1;
                 }
             }
@@ -0,0 +1,170 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#include <manifest.h>
+#include <filereader.h>
+#include <binaryio.h>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+namespace {
+
+const char   magic[]   = "FUDMANIFEST1\n";
+const size_t magicSize = sizeof(magic) - 1;
+
+/*
+Record layout, integers are stored in the machine's byte order:
+    uint32 size of the rest of the record
+    uint64 size, int64 mtime, uint64 hash of the file
+    uint32 length of the path, uint32 number of occurrences
+    the path, not terminated
+    each occurrence: int64 line, int32 position, uint32 length of the URL, the URL
+*/
+const size_t fixedSize      = 8 + 8 + 8 + 4 + 4;
+const size_t occurrenceSize = 8 + 4 + 4;
+
+uint64_t mix(uint64_t value)
+{
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return value;
+}
+
+} //namespace
+
+
+FileManifest::FileManifest(const string &path) : path(path)
+{
+    load();
+}
+
+void FileManifest::load()
+{
+    if (!filesystem::exists(path)) return;
+
+    const MappedFile file(path);
+    if (!file.isOpen() || (file.size() > 0 && (file.size() < magicSize || memcmp(file.data(), magic, magicSize) != 0))) {
+        foreign = true;
+        return;
+    }
+    if (file.size() == 0) return;
+
+    //A damaged record ends the loading, the files after it are simply scanned again
+    const char *in  = file.data() + magicSize;
+    const char *end = file.data() + file.size();
+    while ((size_t)(end - in) >= 4) {
+        const char *record = in;
+        const uint32_t size = binaryio::get<uint32_t>(record);
+        if (size < fixedSize || (size_t)(end - record) < size) break;
+        const char *recordEnd = record + size;
+
+        Record entry;
+        entry.size  = binaryio::get<uint64_t>(record);
+        entry.mtime = binaryio::get<int64_t>(record);
+        entry.hash  = binaryio::get<uint64_t>(record);
+        const uint32_t pathLength = binaryio::get<uint32_t>(record);
+        const uint32_t count      = binaryio::get<uint32_t>(record);
+        if ((size_t)(recordEnd - record) < pathLength) break;
+        string file(record, pathLength);
+        record += pathLength;
+
+        bool valid = (size_t)(recordEnd - record) >= (size_t)count * occurrenceSize;
+        if (valid) entry.occurrences.resize(count);
+        for (uint32_t o = 0; valid && o < count; o++) {
+            if ((size_t)(recordEnd - record) < occurrenceSize) { valid = false; break; }
+            Occurrence &occurrence = entry.occurrences[o];
+            occurrence.lineNum  = binaryio::get<int64_t>(record);
+            occurrence.position = binaryio::get<int32_t>(record);
+            const uint32_t length = binaryio::get<uint32_t>(record);
+            if ((size_t)(recordEnd - record) < length) { valid = false; break; }
+            occurrence.URL.assign(record, length);
+            record += length;
+        }
+        if (!valid || record != recordEnd) break;
+
+        previous[move(file)] = move(entry);
+        in = recordEnd;
+    }
+}
+
+const FileManifest::Record *FileManifest::find(const string &file) const
+{
+    const auto found = previous.find(file);
+    return found != previous.end() ? &found->second : nullptr;
+}
+
+bool FileManifest::save()
+{
+    if (foreign) return false;
+
+    const string temporary = path + ".tmp";
+    FILE *out = fopen(temporary.c_str(), "wb");
+    if (!out) return false;
+
+    fwrite(magic, 1, magicSize, out);
+    string record;
+    for (const auto &entry: current) {
+        const string &file = entry.first;
+        const Record &data = entry.second;
+
+        record.clear();
+        binaryio::put<uint32_t>(record, 0); //Patched below
+        binaryio::put<uint64_t>(record, data.size);
+        binaryio::put<int64_t>(record, data.mtime);
+        binaryio::put<uint64_t>(record, data.hash);
+        binaryio::put<uint32_t>(record, file.size());
+        binaryio::put<uint32_t>(record, data.occurrences.size());
+        record += file;
+        for (const auto &occurrence: data.occurrences) {
+            binaryio::put<int64_t>(record, occurrence.lineNum);
+            binaryio::put<int32_t>(record, occurrence.position);
+            binaryio::put<uint32_t>(record, occurrence.URL.size());
+            record += occurrence.URL;
+        }
+        const uint32_t size = record.size() - 4;
+        memcpy(&record[0], &size, 4);
+
+        fwrite(record.data(), 1, record.size(), out);
+    }
+
+    const bool written = fclose(out) == 0;
+    error_code failed;
+    if (written) filesystem::rename(temporary, path, failed);
+    if (!written || failed) {
+        filesystem::remove(temporary, failed);
+        return false;
+    }
+    return true;
+}
+
+//Not cryptographic, only tells if a file changed: 8 bytes at a time, then the tail
+uint64_t FileManifest::hash(const char *data, size_t size)
+{
+    uint64_t state = 0x9e3779b97f4a7c15ULL ^ size;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        state = (state ^ mix(word)) * 0x9fb21c651e98df25ULL;
+    }
+    uint64_t tail = 0;
+    if (size > i) memcpy(&tail, data + i, size - i);
+    return mix(state ^ mix(tail ^ (size - i)));
+}
@@ -0,0 +1,572 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#include <markup.h>
+#include <filereader.h>
+#include <utf8.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+namespace {
+
+bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f'; }
+bool isAlpha(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+bool isDigit(char c) { return c >= '0' && c <= '9'; }
+char lower(char c)   { return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c; }
+
+string toLower(string text)
+{
+    for (auto &c: text) c = lower(c);
+    return text;
+}
+
+string trim(const string &text)
+{
+    size_t begin = 0, end = text.size();
+    while (begin < end && isSpace(text[begin])) begin++;
+    while (end > begin && isSpace(text[end - 1])) end--;
+    return text.substr(begin, end - begin);
+}
+
+//"prefix" is lower case
+bool startsWithNoCase(const char *p, const char *end, const char *prefix)
+{
+    for (; *prefix; p++, prefix++) {
+        if (p == end || lower(*p) != *prefix) return false;
+    }
+    return true;
+}
+
+//&amp; &lt; &gt; &quot; &apos; and numeric references, the ones seen in links
+string decodeEntities(const char *begin, const char *end)
+{
+    if (!memchr(begin, '&', end - begin)) return string(begin, end);
+
+    string out;
+    out.reserve(end - begin);
+    for (const char *p = begin; p < end; p++) {
+        const char *semicolon = *p == '&' ? static_cast<const char*>(memchr(p, ';', min<size_t>(end - p, 12))) : nullptr;
+        if (!semicolon) {
+            out += *p;
+            continue;
+        }
+        const string name(p + 1, semicolon);
+        if (name == "amp") out += '&';
+        else if (name == "lt") out += '<';
+        else if (name == "gt") out += '>';
+        else if (name == "quot") out += '"';
+        else if (name == "apos") out += '\'';
+        else if (name.size() > 1 && name[0] == '#') {
+            const bool hex = name[1] == 'x' || name[1] == 'X';
+            char *last;
+            const unsigned long code = strtoul(name.c_str() + (hex ? 2 : 1), &last, hex ? 16 : 10);
+            if (*last != '\0' || code == 0 || code > 0x10FFFF) {
+                out += *p;
+                continue;
+            }
+            appendUTF8(out, code);
+        }
+        else {
+            out += *p;
+            continue;
+        }
+        p = semicolon;
+    }
+    return out;
+}
+
+string percentDecode(const string &text)
+{
+    if (text.find('%') == string::npos) return text;
+
+    const auto hexValue = [](char c) {
+        if (isDigit(c)) return c - '0';
+        c = lower(c);
+        return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+    };
+    string out;
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '%' && i + 2 < text.size() && hexValue(text[i + 1]) >= 0 && hexValue(text[i + 2]) >= 0) {
+            out += char(hexValue(text[i + 1]) << 4 | hexValue(text[i + 2]));
+            i += 2;
+        }
+        else out += text[i];
+    }
+    return out;
+}
+
+//'%', '#' and '?' are the only characters of a path that change what a file:// URL means
+string encodePath(const string &path)
+{
+    string out;
+    for (const char c: path) {
+        if (c == '%') out += "%25";
+        else if (c == '#') out += "%23";
+        else if (c == '?') out += "%3F";
+        else out += c;
+    }
+    return out;
+}
+
+bool hasScheme(const string &target)
+{
+    if (target.empty() || !isAlpha(target[0])) return false;
+    size_t i = 1;
+    while (i < target.size() && (isAlpha(target[i]) || isDigit(target[i]) || target[i] == '+' || target[i] == '-' || target[i] == '.')) i++;
+    return i < target.size() && target[i] == ':';
+}
+
+//RFC 3986 5.2.4, for targets resolved against a <base> URL
+string removeDotSegments(const string &path)
+{
+    vector<string> segments;
+    bool directory = false;
+    size_t begin = 1;
+    while (begin <= path.size()) {
+        const size_t end = min(path.find('/', begin), path.size());
+        const string segment = path.substr(begin, end - begin);
+        directory = segment == "." || segment == "..";
+        if (segment == "..") {
+            if (!segments.empty()) segments.pop_back();
+        }
+        else if (segment != ".") segments.push_back(segment);
+        begin = end + 1;
+    }
+
+    string out;
+    for (const auto &segment: segments) out += '/' + segment;
+    if (directory || out.empty()) out += '/';
+    return out;
+}
+
+class Tokenizer
+{
+public:
+    Tokenizer(const char *text, size_t size) : text(text), size(size) {}
+
+    //What's wanted, nullptr = not collected
+    vector<MarkupScanner::Link> *links   = nullptr;
+    string                      *base    = nullptr;
+    unordered_set<string>       *anchors = nullptr;
+
+    void html()
+    {
+        size_t p = 0;
+        while (p < size) {
+            const void *lt = memchr(text + p, '<', size - p);
+            if (!lt) break;
+            p = tag(static_cast<const char*>(lt) - text);
+        }
+    }
+
+    void markdown();
+
+private:
+    size_t tag(size_t at);
+    void attribute(const string &tag, const string &name, size_t begin, size_t end);
+    size_t inlines(size_t p, size_t end);
+    size_t paragraphEnd(size_t p) const;
+    void heading(const char *begin, const char *end);
+
+    void link(size_t begin, size_t end)
+    {
+        if (links) links->push_back({begin, decodeEntities(text + begin, text + end)});
+    }
+
+    const char *const text;
+    const size_t      size;
+    unordered_map<string, int> headings; //GitHub adds -1, -2... to the ids already taken
+};
+
+//Parses the markup starting with the '<' at "at", returns where the text goes on
+size_t Tokenizer::tag(size_t at)
+{
+    const char *const end = text + size;
+    const char *p = text + at + 1;
+
+    if (startsWithNoCase(p, end, "!--")) {
+        const size_t close = string_view(text, size).find("-->", p + 3 - text);
+        return close == string_view::npos ? size : close + 3;
+    }
+    if (p < end && (*p == '!' || *p == '?' || *p == '/')) {
+        const void *gt = memchr(p, '>', end - p);
+        return gt ? static_cast<const char*>(gt) - text + 1 : size;
+    }
+    if (p == end || !isAlpha(*p)) return at + 1;
+
+    string name;
+    while (p < end && (isAlpha(*p) || isDigit(*p) || *p == '-' || *p == ':')) name += lower(*p++);
+
+    for (;;) {
+        while (p < end && isSpace(*p)) p++;
+        if (p == end) return size;
+        if (*p == '>') {
+            p++;
+            break;
+        }
+        const char *attrBegin = p;
+        while (p < end && !isSpace(*p) && *p != '=' && *p != '>' && *p != '/') p++;
+        if (p == attrBegin) {
+            p++;
+            continue;
+        }
+        const string attr = toLower(string(attrBegin, p));
+
+        while (p < end && isSpace(*p)) p++;
+        if (p == end || *p != '=') continue;
+        p++;
+        while (p < end && isSpace(*p)) p++;
+        if (p == end) return size;
+
+        const char *valueBegin, *valueEnd;
+        if (*p == '"' || *p == '\'') {
+            const void *quote = memchr(p + 1, *p, end - p - 1);
+            if (!quote) return size;
+            valueBegin = p + 1;
+            valueEnd   = static_cast<const char*>(quote);
+            p = valueEnd + 1;
+        }
+        else {
+            valueBegin = p;
+            while (p < end && !isSpace(*p) && *p != '>') p++;
+            valueEnd = p;
+        }
+        attribute(name, attr, valueBegin - text, valueEnd - text);
+    }
+
+    //Their content isn't markup, URLs in scripts are only found when they're absolute
+    if (name == "script" || name == "style") {
+        const string closing = "</" + name;
+        for (const char *q = p; q < end; q++) {
+            q = static_cast<const char*>(memchr(q, '<', end - q));
+            if (!q) break;
+            if (startsWithNoCase(q, end, closing.c_str())) return q - text;
+        }
+        return size;
+    }
+    return p - text;
+}
+
+void Tokenizer::attribute(const string &tag, const string &name, size_t begin, size_t end)
+{
+    if (name == "href" && tag == "base") {
+        if (base) *base = decodeEntities(text + begin, text + end);
+    }
+    else if (name == "href" || name == "src") link(begin, end);
+    else if (name == "id" || (name == "name" && tag == "a")) {
+        if (anchors) anchors->insert(decodeEntities(text + begin, text + end));
+    }
+}
+
+//Links, images, code spans and tags of a line of Markdown, returns where the text goes on:
+//past "end" when a tag doesn't end on this line
+size_t Tokenizer::inlines(size_t p, size_t end)
+{
+    while (p < end) {
+        const char c = text[p];
+        if (c == '\\') p += 2;
+        else if (c == '`') {
+            size_t run = 1;
+            while (p + run < end && text[p + run] == '`') run++;
+            size_t q = p + run;
+            p += run;
+            while (q < end) {
+                if (text[q] != '`') {
+                    q++;
+                    continue;
+                }
+                size_t closing = 1;
+                while (q + closing < end && text[q + closing] == '`') closing++;
+                q += closing;
+                if (closing == run) {
+                    p = q;
+                    break;
+                }
+            }
+        }
+        else if (c == '<') {
+            //"a<b" in prose: a tag that no '>' closes before the next blank line isn't one
+            if (p + 1 < end && isAlpha(text[p + 1]) && !memchr(text + p, '>', paragraphEnd(p) - p)) {
+                p++;
+                continue;
+            }
+            const size_t after = tag(p);
+            if (after > end) return after;
+            p = after;
+        }
+        else if (c == ']' && p + 1 < end && text[p + 1] == '(') {
+            size_t target = p + 2;
+            while (target < end && (text[target] == ' ' || text[target] == '\t')) target++;
+            size_t targetEnd = target;
+            if (target < end && text[target] == '<') {
+                const void *gt = memchr(text + target, '>', end - target);
+                if (!gt) {
+                    p = target;
+                    continue;
+                }
+                target++;
+                targetEnd = static_cast<const char*>(gt) - text;
+            }
+            else {
+                //Parentheses are allowed in the target as long as they're balanced
+                int depth = 0;
+                while (targetEnd < end && !isSpace(text[targetEnd])) {
+                    if (text[targetEnd] == '(') depth++;
+                    else if (text[targetEnd] == ')' && depth-- == 0) break;
+                    targetEnd++;
+                }
+            }
+            if (targetEnd > target) link(target, targetEnd);
+            p = targetEnd;
+        }
+        else p++;
+    }
+    return end;
+}
+
+//Where the paragraph of "p" ends: at the next blank line, or at the end of the text
+size_t Tokenizer::paragraphEnd(size_t p) const
+{
+    for (;;) {
+        const void *newline = memchr(text + p, '\n', size - p);
+        if (!newline) return size;
+        p = static_cast<const char*>(newline) - text + 1;
+        size_t q = p;
+        while (q < size && (text[q] == ' ' || text[q] == '\t' || text[q] == '\r')) q++;
+        if (q == size || text[q] == '\n') return p;
+    }
+}
+
+//The id GitHub gives a heading: lower case, spaces turned into '-', punctuation removed
+void Tokenizer::heading(const char *begin, const char *end)
+{
+    if (!anchors) return;
+    while (begin < end && isSpace(*begin)) begin++;
+    while (end > begin && isSpace(end[-1])) end--;
+
+    string id;
+    for (const char *p = begin; p < end; p++) {
+        //Only the text of a link is part of the id
+        if (*p == ']' && p + 1 < end && p[1] == '(') {
+            const void *close = memchr(p, ')', end - p);
+            if (close) {
+                p = static_cast<const char*>(close);
+                continue;
+            }
+        }
+        if (static_cast<unsigned char>(*p) >= 0x80 || isDigit(*p) || *p == '-' || *p == '_') id += *p;
+        else if (isAlpha(*p)) id += lower(*p);
+        else if (*p == ' ') id += '-';
+    }
+    const int taken = headings[id]++;
+    anchors->insert(taken ? id + '-' + to_string(taken) : id);
+}
+
+void Tokenizer::markdown()
+{
+    const char *const end = text + size;
+    string fence; //Opening ``` or ~~~ of the code block we're in
+    const char *paragraph = nullptr, *paragraphEnd = nullptr; //Previous line, a heading if underlined
+
+    size_t p = 0;
+    while (p < size) {
+        const char *line = text + p;
+        const char *lineEnd = static_cast<const char*>(memchr(line, '\n', end - line));
+        if (!lineEnd) lineEnd = end;
+        const size_t next = lineEnd - text + 1;
+
+        const char *first = line;
+        while (first < lineEnd && first - line < 3 && *first == ' ') first++;
+        const char *last = lineEnd;
+        while (last > first && isSpace(last[-1])) last--;
+
+        //Code blocks
+        if (last - first >= 3 && (*first == '`' || *first == '~') && first[1] == *first && first[2] == *first) {
+            size_t length = 3;
+            while (first + length < last && first[length] == *first) length++;
+            if (fence.empty()) fence.assign(first, length);
+            else if (*first == fence[0] && length >= fence.size() && first + length == last) fence.clear();
+            paragraph = nullptr;
+            p = next;
+            continue;
+        }
+        if (!fence.empty() || last == first) {
+            paragraph = nullptr;
+            p = next;
+            continue;
+        }
+
+        //# Heading
+        if (*first == '#') {
+            const char *hashes = first;
+            while (hashes < last && *hashes == '#') hashes++;
+            if (hashes - first <= 6 && (hashes == last || *hashes == ' ' || *hashes == '\t')) {
+                const char *title = last;
+                while (title > hashes && title[-1] == '#') title--;
+                heading(hashes, title > hashes && isSpace(title[-1]) ? title : last);
+                paragraph = nullptr;
+                p = max(next, inlines(hashes - text, lineEnd - text));
+                continue;
+            }
+        }
+
+        //Heading\n=======
+        if (paragraph && (*first == '=' || *first == '-')) {
+            const char *underline = first;
+            while (underline < last && *underline == *first) underline++;
+            if (underline == last) {
+                heading(paragraph, paragraphEnd);
+                paragraph = nullptr;
+                p = next;
+                continue;
+            }
+        }
+
+        //[label]: target
+        if (*first == '[') {
+            const char *close = static_cast<const char*>(memchr(first, ']', last - first));
+            if (close && close + 1 < last && close[1] == ':') {
+                const char *target = close + 2;
+                while (target < last && isSpace(*target)) target++;
+                const char *targetEnd = target;
+                if (target < last && *target == '<') {
+                    target++;
+                    const void *gt = memchr(target, '>', last - target);
+                    targetEnd = gt ? static_cast<const char*>(gt) : target;
+                }
+                else while (targetEnd < last && !isSpace(*targetEnd)) targetEnd++;
+
+                if (targetEnd > target) link(target - text, targetEnd - text);
+                paragraph = nullptr;
+                p = next;
+                continue;
+            }
+        }
+
+        const size_t after = inlines(p, lineEnd - text);
+        paragraph    = after > size_t(lineEnd - text) ? nullptr : first;
+        paragraphEnd = last;
+        p = max(next, after);
+    }
+}
+
+} //namespace
+
+
+MarkupScanner::Kind MarkupScanner::kindOf(const string &path)
+{
+    const size_t dot = path.find_last_of("./\\");
+    if (dot == string::npos || path[dot] != '.') return None;
+
+    const string extension = toLower(path.substr(dot + 1));
+    if (extension == "html" || extension == "htm" || extension == "xhtml") return HTML;
+    if (extension == "md" || extension == "markdown") return Markdown;
+    return None;
+}
+
+void MarkupScanner::links(const char *text, size_t size, Kind kind, vector<Link> &links, string &base)
+{
+    Tokenizer tokenizer(text, size);
+    tokenizer.links = &links;
+    tokenizer.base  = &base;
+    if (kind == HTML) tokenizer.html();
+    else if (kind == Markdown) tokenizer.markdown();
+}
+
+void MarkupScanner::anchors(const char *text, size_t size, Kind kind, unordered_set<string> &anchors)
+{
+    Tokenizer tokenizer(text, size);
+    tokenizer.anchors = &anchors;
+    if (kind == HTML) tokenizer.html();
+    else if (kind == Markdown) tokenizer.markdown();
+}
+
+string MarkupScanner::resolve(const string &file, const string &base, const string &target)
+{
+    const string relative = trim(target);
+    if (relative.empty() || relative.compare(0, 2, "//") == 0 || hasScheme(relative)) return string();
+
+    const size_t pathEnd = min(relative.find_first_of("?#"), relative.size());
+    const string path = relative.substr(0, pathEnd);
+    const size_t hash = relative.find('#');
+    const string fragment = hash == string::npos ? string() : relative.substr(hash);
+
+    filesystem::path directory = filesystem::absolute(file).parent_path();
+    const string baseURL = trim(base);
+    if (hasScheme(baseURL)) {
+        //A page of a website, its links are URLs of the website
+        const size_t authority = baseURL.find("://");
+        if (authority == string::npos) return string();
+        const size_t baseEnd  = min(baseURL.find_first_of("?#"), baseURL.size());
+        const size_t basePath = min(baseURL.find('/', authority + 3), baseEnd);
+        const string origin = baseURL.substr(0, basePath);
+        const string directoryPath = baseURL.substr(basePath, baseEnd - basePath);
+
+        if (path.empty()) return baseURL.substr(0, relative[0] == '#' ? min(baseURL.find('#'), baseURL.size()) : baseEnd) + relative;
+        const string merged = path[0] == '/' ? path : directoryPath.substr(0, directoryPath.rfind('/') + 1) + path;
+        return origin + removeDotSegments(merged[0] == '/' ? merged : '/' + merged) + relative.substr(pathEnd);
+    }
+    if (!baseURL.empty()) {
+        //The root of the website isn't known
+        if (baseURL[0] == '/') return string();
+        directory = (directory / percentDecode(baseURL.substr(0, baseURL.rfind('/') + 1))).lexically_normal();
+    }
+
+    //Same as above, and the file system has no idea where the website starts
+    if (!path.empty() && path[0] == '/') return string();
+
+    const filesystem::path resolved = path.empty() ? filesystem::absolute(file).lexically_normal()
+                                                   : (directory / percentDecode(path)).lexically_normal();
+    const string generic = resolved.generic_string();
+    return "file://" + string(generic[0] == '/' ? "" : "/") + encodePath(generic) + fragment;
+}
+
+
+string LocalLinks::check(const string &URL)
+{
+    string path = URL.substr(URL.compare(0, 8, "file:///") == 0 && URL.size() > 10 && URL[9] == ':' ? 8 : 7);
+    string fragment;
+    const size_t hash = path.find('#');
+    if (hash != string::npos) {
+        fragment = percentDecode(path.substr(hash + 1));
+        path.erase(hash);
+    }
+    path = percentDecode(path);
+
+    Target &target = targets[path];
+    if (!target.looked) {
+        target.looked = true;
+        error_code failed;
+        const filesystem::file_status status = filesystem::status(path, failed);
+        target.exists = !failed && filesystem::exists(status);
+        if (target.exists && !filesystem::is_directory(status)) target.kind = MarkupScanner::kindOf(path);
+    }
+    if (!target.exists) return "No such file or directory";
+
+    //Other files have no anchors we know of (#page=2 of a PDF, #L10 of a source file...)
+    if (fragment.empty() || fragment == "top" || target.kind == MarkupScanner::None) return string();
+
+    if (!target.indexed) {
+        const MappedFile file(path);
+        if (file.isOpen()) MarkupScanner::anchors(file.data(), file.size(), target.kind, target.anchors);
+        target.indexed = true;
+    }
+    if (target.anchors.count(fragment)) return string();
+    if (target.kind == MarkupScanner::Markdown && target.anchors.count(toLower(fragment))) return string();
+    return "No anchor \"#" + fragment + "\" in the file";
+}
@@ -0,0 +1,240 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <metrics.h>
+
+const char *const RequestMetrics::phaseNames[phases] = { "dns", "connect", "tls", "wait", "total" };
+
+namespace {
+    //Microseconds as seconds, the unit Prometheus expects
+    string seconds(double us)
+    {
+        char text[32];
+        snprintf(text, sizeof text, "%.6f", us / 1e6);
+        return text;
+    }
+
+    string milliseconds(double us)
+    {
+        char text[32];
+        snprintf(text, sizeof text, "%.3f", us / 1e3);
+        return text;
+    }
+
+    //Label values and JSON strings share the same escapes for what a host can contain
+    string escaped(const string &text)
+    {
+        string out;
+        for (const char c: text) {
+            if (c == '\\' || c == '"') out += '\\';
+            if (c == '\n') out += "\\n";
+            else out += c;
+        }
+        return out;
+    }
+}
+
+void Histogram::add(long us)
+{
+    us = std::max(us, 0L);
+    const size_t b = lower_bound(bounds.begin(), bounds.end(), us) - bounds.begin();
+    counts[b]++;
+    total++;
+    sumUs += us;
+    maxUs = std::max(maxUs, us);
+}
+
+long Histogram::quantile(double q) const
+{
+    if (total == 0) return 0;
+    const double rank = q * total;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < counts.size(); b++) {
+        if (counts[b] > 0 && seen + counts[b] >= rank) {
+            const double lower = b == 0 ? 0 : bounds[b - 1];
+            const double upper = b < bounds.size() ? bounds[b] : maxUs;
+            const double estimate = lower + (upper - lower) * (rank - seen) / counts[b];
+            return std::min((long)estimate, maxUs);
+        }
+        seen += counts[b];
+    }
+    return maxUs;
+}
+
+void RequestMetrics::add(const RequestSample &sample)
+{
+    histograms[DNS].add(sample.dns);
+    histograms[Connect].add(sample.connect);
+    histograms[TLS].add(sample.tls);
+    histograms[Wait].add(sample.wait);
+    histograms[Total].add(sample.total);
+
+    requests++;
+    if (sample.failed) failed++;
+    redirects += sample.redirects;
+    received  += sample.received;
+    sent      += sample.sent;
+    const long statusClass = sample.httpCode / 100;
+    classes[statusClass >= 1 && statusClass <= 5 ? statusClass : 0]++;
+}
+
+void NetworkMetrics::record(const string &host, const RequestSample &sample)
+{
+    all.add(sample);
+    hosts[host].add(sample);
+}
+
+void NetworkMetrics::printSummary(size_t maxHosts) const
+{
+    if (empty()) return;
+    const auto ms = [](long us) { return milliseconds(us); };
+
+    cout << "Request timings in milliseconds, " << all.requests << " request(s), " << all.failed << " without answer, "
+         << all.redirects << " redirect(s), " << all.received << " byte(s) received:\n";
+    cout << "\t" << left << setw(14) << "Phase" << right << setw(12) << "p50" << setw(12) << "p95"
+         << setw(12) << "p99" << setw(12) << "max" << '\n';
+    for (size_t p = 0; p < RequestMetrics::phases; p++) {
+        const Histogram &histogram = all.histograms[p];
+        cout << "\t" << left << setw(14) << RequestMetrics::phaseNames[p] << right
+             << setw(12) << ms(histogram.quantile(0.50)) << setw(12) << ms(histogram.quantile(0.95))
+             << setw(12) << ms(histogram.quantile(0.99)) << setw(12) << ms(histogram.max()) << '\n';
+    }
+
+    //Slowest first, by the 95th percentile of their total time
+    vector<const pair<const string, RequestMetrics>*> sorted;
+    for (const auto &host: hosts) sorted.push_back(&host);
+    sort(sorted.begin(), sorted.end(), [](const auto *a, const auto *b) {
+        return a->second.histograms[RequestMetrics::Total].quantile(0.95) > b->second.histograms[RequestMetrics::Total].quantile(0.95);
+    });
+    if (sorted.size() > maxHosts) sorted.resize(maxHosts);
+
+    cout << "Slowest hosts (" << sorted.size() << " of " << hosts.size() << "), total time in milliseconds:\n";
+    cout << "\t" << left << setw(40) << "Host" << right << setw(10) << "requests" << setw(10) << "failed"
+         << setw(12) << "p50" << setw(12) << "p95" << setw(12) << "max" << setw(12) << "connect p50" << '\n';
+    for (const auto *host: sorted) {
+        const RequestMetrics &metrics = host->second;
+        const Histogram &total = metrics.histograms[RequestMetrics::Total];
+        cout << "\t" << left << setw(40) << host->first << right << setw(10) << metrics.requests
+             << setw(10) << metrics.failed << setw(12) << ms(total.quantile(0.50))
+             << setw(12) << ms(total.quantile(0.95)) << setw(12) << ms(total.max())
+             << setw(12) << ms(metrics.histograms[RequestMetrics::Connect].quantile(0.50)) << '\n';
+    }
+}
+
+bool NetworkMetrics::write(const string &path) const
+{
+    const bool isJSON = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    const string text = isJSON ? json() : prometheus();
+
+    //Collectors reading the file never see half of it
+    const string temporary = path + ".tmp";
+    FILE *out = fopen(temporary.c_str(), "wb");
+    if (!out) return false;
+    const bool written = fwrite(text.data(), 1, text.size(), out) == text.size() && fclose(out) == 0;
+
+    error_code failed;
+    if (written) filesystem::rename(temporary, path, failed);
+    if (!written || failed) {
+        filesystem::remove(temporary, failed);
+        return false;
+    }
+    return true;
+}
+
+string NetworkMetrics::prometheus() const
+{
+    string text;
+    const auto histograms = [&text](const string &name, const string &labels, const RequestMetrics &metrics) {
+        for (size_t p = 0; p < RequestMetrics::phases; p++) {
+            const Histogram &histogram = metrics.histograms[p];
+            const string phase = labels + "phase=\"" + RequestMetrics::phaseNames[p] + "\"";
+            uint64_t cumulative = 0;
+            for (size_t b = 0; b <= Histogram::bounds.size(); b++) {
+                cumulative += histogram.bucket(b);
+                const string le = b < Histogram::bounds.size() ? seconds(Histogram::bounds[b]) : "+Inf";
+                text += name + "_bucket{" + phase + ",le=\"" + le + "\"} " + to_string(cumulative) + '\n';
+            }
+            text += name + "_sum{" + phase + "} " + seconds(histogram.sum()) + '\n';
+            text += name + "_count{" + phase + "} " + to_string(histogram.count()) + '\n';
+        }
+    };
+    text += "# HELP fud_request_phase_seconds Time spent in each phase of the requests of the last run.\n"
+            "# TYPE fud_request_phase_seconds histogram\n";
+    histograms("fud_request_phase_seconds", "", all);
+    text += "# HELP fud_host_request_phase_seconds Time spent in each phase of the requests, per host.\n"
+            "# TYPE fud_host_request_phase_seconds histogram\n";
+    for (const auto &host: hosts) histograms("fud_host_request_phase_seconds", "host=\"" + escaped(host.first) + "\",", host.second);
+
+    //Per host only, a total would be counted twice by sum()
+    static const char *const classNames[] = { "none", "1xx", "2xx", "3xx", "4xx", "5xx" };
+    text += "# HELP fud_requests_total Requests by class of HTTP status, \"none\" without an HTTP answer.\n"
+            "# TYPE fud_requests_total counter\n";
+    for (const auto &host: hosts)
+        for (size_t c = 0; c < host.second.classes.size(); c++)
+            text += "fud_requests_total{host=\"" + escaped(host.first) + "\",code=\"" + classNames[c] + "\"} " +
+                    to_string(host.second.classes[c]) + '\n';
+
+    const auto counter = [this, &text](const string &name, const string &help, uint64_t RequestMetrics::*value) {
+        text += "# HELP " + name + ' ' + help + "\n# TYPE " + name + " counter\n";
+        for (const auto &host: hosts)
+            text += name + "{host=\"" + escaped(host.first) + "\"} " + to_string(host.second.*value) + '\n';
+    };
+    counter("fud_requests_failed_total", "Requests that got no answer at all.", &RequestMetrics::failed);
+    counter("fud_redirects_total", "Redirects followed.", &RequestMetrics::redirects);
+    counter("fud_received_bytes_total", "Bytes received, headers included.", &RequestMetrics::received);
+    counter("fud_sent_bytes_total", "Bytes of the requests sent.", &RequestMetrics::sent);
+    return text;
+}
+
+string NetworkMetrics::json() const
+{
+    const auto metricsJSON = [](const RequestMetrics &metrics) {
+        string text = "{\"requests\":" + to_string(metrics.requests) + ",\"failed\":" + to_string(metrics.failed) +
+                      ",\"redirects\":" + to_string(metrics.redirects) + ",\"received_bytes\":" + to_string(metrics.received) +
+                      ",\"sent_bytes\":" + to_string(metrics.sent) + ",\"status_classes\":{";
+        static const char *const classNames[] = { "none", "1xx", "2xx", "3xx", "4xx", "5xx" };
+        for (size_t c = 0; c < metrics.classes.size(); c++)
+            text += string(c ? "," : "") + "\"" + classNames[c] + "\":" + to_string(metrics.classes[c]);
+        text += "},\"phases_ms\":{";
+        for (size_t p = 0; p < RequestMetrics::phases; p++) {
+            const Histogram &histogram = metrics.histograms[p];
+            text += string(p ? "," : "") + "\"" + RequestMetrics::phaseNames[p] + "\":{\"count\":" + to_string(histogram.count()) +
+                    ",\"sum\":" + milliseconds(histogram.sum()) + ",\"p50\":" + milliseconds(histogram.quantile(0.50)) +
+                    ",\"p95\":" + milliseconds(histogram.quantile(0.95)) + ",\"p99\":" + milliseconds(histogram.quantile(0.99)) +
+                    ",\"max\":" + milliseconds(histogram.max()) + ",\"buckets\":[";
+            for (size_t b = 0; b <= Histogram::bounds.size(); b++) {
+                const string le = b < Histogram::bounds.size() ? milliseconds(Histogram::bounds[b]) : "null";
+                text += string(b ? "," : "") + "{\"le\":" + le + ",\"count\":" + to_string(histogram.bucket(b)) + "}";
+            }
+            text += "]}";
+        }
+        return text + "}}";
+    };
+
+    string text = "{\"all\":" + metricsJSON(all) + ",\"hosts\":{";
+    bool first = true;
+    for (const auto &host: hosts) {
+        text += string(first ? "" : ",") + "\n\"" + escaped(host.first) + "\":" + metricsJSON(host.second);
+        first = false;
+    }
+    return text + "}}\n";
+}
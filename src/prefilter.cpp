@@ -0,0 +1,161 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#include <prefilter.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+    #define FUD_X86 1
+    #include <emmintrin.h>
+    #if defined(__GNUC__) || defined(__clang__)
+        #define FUD_AVX2 1
+        #include <immintrin.h>
+    #endif
+#endif
+
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
+namespace {
+
+inline bool isCandidate(const char *p, const char *end)
+{
+    if (p + 1 < end && p[0] == ':' && p[1] == '/') return true;
+    return p + 3 < end &&
+           (p[0] | 0x20) == 'w' && (p[1] | 0x20) == 'w' && (p[2] | 0x20) == 'w' && p[3] == '.';
+}
+
+inline unsigned firstBit(unsigned mask)
+{
+    #ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return index;
+    #else
+        return __builtin_ctz(mask);
+    #endif
+}
+
+size_t nextScalar(const char *text, size_t size, size_t from)
+{
+    const char *end = text + size;
+    for (const char *p = text + from; p < end; p++) {
+        if (isCandidate(p, end)) return p - text;
+    }
+    return size;
+}
+
+#ifdef FUD_X86
+size_t nextSSE2(const char *text, size_t size, size_t from)
+{
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i slash = _mm_set1_epi8('/');
+    const __m128i w     = _mm_set1_epi8('w');
+    const __m128i dot   = _mm_set1_epi8('.');
+    const __m128i lower = _mm_set1_epi8(0x20);
+
+    size_t i = from;
+    //Every block reads 3 bytes past its end for the "www." test
+    for (; i + 16 + 3 <= size; i += 16) {
+        const __m128i b0 = _mm_loadu_si128((const __m128i*)(text + i));
+        const __m128i b1 = _mm_loadu_si128((const __m128i*)(text + i + 1));
+        const __m128i b2 = _mm_loadu_si128((const __m128i*)(text + i + 2));
+        const __m128i b3 = _mm_loadu_si128((const __m128i*)(text + i + 3));
+
+        const __m128i scheme = _mm_and_si128(_mm_cmpeq_epi8(b0, colon), _mm_cmpeq_epi8(b1, slash));
+        const __m128i www    = _mm_and_si128(
+                               _mm_and_si128(_mm_cmpeq_epi8(_mm_or_si128(b0, lower), w),
+                                             _mm_cmpeq_epi8(_mm_or_si128(b1, lower), w)),
+                               _mm_and_si128(_mm_cmpeq_epi8(_mm_or_si128(b2, lower), w),
+                                             _mm_cmpeq_epi8(b3, dot)));
+
+        const unsigned mask = _mm_movemask_epi8(_mm_or_si128(scheme, www));
+        if (mask) return i + firstBit(mask);
+    }
+    return nextScalar(text, size, i);
+}
+#endif
+
+#ifdef FUD_AVX2
+__attribute__((target("avx2")))
+size_t nextAVX2(const char *text, size_t size, size_t from)
+{
+    const __m256i colon = _mm256_set1_epi8(':');
+    const __m256i slash = _mm256_set1_epi8('/');
+    const __m256i w     = _mm256_set1_epi8('w');
+    const __m256i dot   = _mm256_set1_epi8('.');
+    const __m256i lower = _mm256_set1_epi8(0x20);
+
+    size_t i = from;
+    for (; i + 32 + 3 <= size; i += 32) {
+        const __m256i b0 = _mm256_loadu_si256((const __m256i*)(text + i));
+        const __m256i b1 = _mm256_loadu_si256((const __m256i*)(text + i + 1));
+        const __m256i b2 = _mm256_loadu_si256((const __m256i*)(text + i + 2));
+        const __m256i b3 = _mm256_loadu_si256((const __m256i*)(text + i + 3));
+
+        const __m256i scheme = _mm256_and_si256(_mm256_cmpeq_epi8(b0, colon), _mm256_cmpeq_epi8(b1, slash));
+        const __m256i www    = _mm256_and_si256(
+                               _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_or_si256(b0, lower), w),
+                                                _mm256_cmpeq_epi8(_mm256_or_si256(b1, lower), w)),
+                               _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_or_si256(b2, lower), w),
+                                                _mm256_cmpeq_epi8(b3, dot)));
+
+        const unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(scheme, www));
+        if (mask) return i + firstBit(mask);
+    }
+    return nextSSE2(text, size, i);
+}
+#endif
+
+using NextFunction = size_t (*)(const char*, size_t, size_t);
+
+struct Implementation
+{
+    NextFunction function;
+    const char  *name;
+};
+
+Implementation pick()
+{
+    #ifdef FUD_AVX2
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return {nextAVX2, "AVX2"};
+    #endif
+    #ifdef FUD_X86
+        return {nextSSE2, "SSE2"};
+    #else
+        return {nextScalar, "scalar"};
+    #endif
+}
+
+const Implementation &selected()
+{
+    static const Implementation implementation = pick();
+    return implementation;
+}
+
+} //namespace
+
+
+size_t AnchorFilter::next(const char *text, size_t size, size_t from)
+{
+    if (from >= size) return size;
+    return selected().function(text, size, from);
+}
+
+const char *AnchorFilter::implementation()
+{
+    return selected().name;
+}
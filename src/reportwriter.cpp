@@ -0,0 +1,235 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#include <reportwriter.h>
+#include <versions.h>
+
+namespace {
+    //Control characters, quotes and backslashes, the rest is copied as is (UTF-8)
+    void appendJSON(string &buffer, const string &text)
+    {
+        buffer += '"';
+        for (const unsigned char c: text) {
+            switch (c) {
+            case '"':  buffer += "\\\""; break;
+            case '\\': buffer += "\\\\"; break;
+            case '\n': buffer += "\\n";  break;
+            case '\r': buffer += "\\r";  break;
+            case '\t': buffer += "\\t";  break;
+            default:
+                if (c < 0x20) {
+                    char escaped[8];
+                    snprintf(escaped, sizeof escaped, "\\u%04x", c);
+                    buffer += escaped;
+                }
+                else buffer += (char)c;
+            }
+        }
+        buffer += '"';
+    }
+
+    //Quoted only when needed, quotes are doubled (RFC 4180)
+    void appendCSV(string &buffer, const string &text)
+    {
+        if (text.find_first_of(",\"\r\n") == string::npos) {
+            buffer += text;
+            return;
+        }
+        buffer += '"';
+        for (const char c: text) {
+            if (c == '"') buffer += '"';
+            buffer += c;
+        }
+        buffer += '"';
+    }
+
+    //Microseconds as milliseconds with 3 decimals
+    string millis(long us)
+    {
+        char text[32];
+        snprintf(text, sizeof text, "%ld.%03ld", us / 1000, us % 1000);
+        return text;
+    }
+}
+
+bool ReportWriter::parseFormat(const string &name, Format &format)
+{
+    if (name == "jsonl")      format = JsonLines;
+    else if (name == "csv")   format = CSV;
+    else if (name == "sarif") format = SARIF;
+    else return false;
+    return true;
+}
+
+ReportWriter::ReportWriter(Format format, const string &path) :
+    format_(format)
+{
+    if (toStandardOutput(path)) out = stdout;
+    else {
+        out   = fopen(path.c_str(), "wb");
+        owned = out != nullptr;
+    }
+    if (!out) return;
+
+    string buffer;
+    header(buffer);
+    if (!buffer.empty() && fwrite(buffer.data(), 1, buffer.size(), out) != buffer.size()) failed = true;
+    writer = thread(&ReportWriter::loop, this);
+}
+
+ReportWriter::~ReportWriter()
+{
+    close();
+}
+
+void ReportWriter::write(ReportRecord &&record)
+{
+    if (!out) return;
+    {
+        lock_guard<mutex> guard(lock);
+        pending.push_back(move(record));
+        //The writer is already awake if something was pending
+        if (pending.size() > 1) return;
+    }
+    wakeup.notify_one();
+}
+
+bool ReportWriter::close()
+{
+    if (!out) return !failed;
+    {
+        lock_guard<mutex> guard(lock);
+        closing = true;
+    }
+    wakeup.notify_one();
+    if (writer.joinable()) writer.join();
+
+    string buffer;
+    footer(buffer);
+    if (!buffer.empty() && fwrite(buffer.data(), 1, buffer.size(), out) != buffer.size()) failed = true;
+    if (owned) {
+        if (fclose(out) != 0) failed = true;
+    }
+    else if (fflush(out) != 0) failed = true;
+    out = nullptr;
+    return !failed;
+}
+
+void ReportWriter::loop()
+{
+    vector<ReportRecord> batch;
+    string buffer;
+    unique_lock<mutex> guard(lock);
+    while (true) {
+        wakeup.wait(guard, [this] { return closing || !pending.empty(); });
+        batch.swap(pending);
+        const bool last = closing;
+        guard.unlock();
+
+        for (const auto &record: batch) format(record, buffer);
+        batch.clear();
+        if (!buffer.empty()) {
+            if (fwrite(buffer.data(), 1, buffer.size(), out) != buffer.size()) failed = true;
+            //Readers follow the report as it grows
+            fflush(out);
+            buffer.clear();
+        }
+
+        guard.lock();
+        if (last && pending.empty()) return;
+    }
+}
+
+void ReportWriter::header(string &buffer) const
+{
+    if (format_ == CSV)
+        buffer += "file,line,column,url,final_url,status,http_code,curl_code,error,origin,"
+                  "elapsed_ms,dns_ms,connect_ms,tls_ms,first_byte_ms,total_ms,redirects,received_bytes\n";
+    else if (format_ == SARIF) {
+        buffer += "{\"version\":\"2.1.0\",\"$schema\":\"https://json.schemastore.org/sarif-2.1.0.json\",\"runs\":[{"
+                  "\"tool\":{\"driver\":{\"name\":";
+        appendJSON(buffer, Product::shortName);
+        buffer += ",\"fullName\":";
+        appendJSON(buffer, Product::name);
+        buffer += ",\"version\":";
+        appendJSON(buffer, Product::version);
+        buffer += ",\"informationUri\":";
+        appendJSON(buffer, "https://" + Developer::domain);
+        buffer += ",\"rules\":[{\"id\":\"dead-link\",\"shortDescription\":{\"text\":\"Dead link\"}},"
+                  "{\"id\":\"unreachable-host\",\"shortDescription\":{\"text\":\"Host unreachable, link not checked\"}}]}},"
+                  "\"results\":[\n";
+    }
+}
+
+void ReportWriter::footer(string &buffer) const
+{
+    if (format_ == SARIF) buffer += "\n]}]}\n";
+}
+
+void ReportWriter::format(const ReportRecord &record, string &buffer)
+{
+    if (format_ == JsonLines) {
+        buffer += "{\"file\":";
+        appendJSON(buffer, record.file);
+        buffer += ",\"line\":" + to_string(record.line) + ",\"column\":" + to_string(record.column) + ",\"url\":";
+        appendJSON(buffer, record.URL);
+        buffer += ",\"final_url\":";
+        appendJSON(buffer, record.finalURL);
+        buffer += ",\"status\":";
+        appendJSON(buffer, record.status);
+        buffer += ",\"http_code\":" + to_string(record.httpCode) + ",\"curl_code\":" + to_string(record.curlCode) + ",\"error\":";
+        appendJSON(buffer, record.error);
+        buffer += ",\"origin\":";
+        appendJSON(buffer, record.origin);
+        buffer += ",\"elapsed_ms\":" + to_string(record.elapsed) +
+                  ",\"timings_ms\":{\"dns\":" + millis(record.dns) + ",\"connect\":" + millis(record.connect) +
+                  ",\"tls\":" + millis(record.tls) + ",\"first_byte\":" + millis(record.firstByte) +
+                  ",\"total\":" + millis(record.total) + "},\"redirects\":" + to_string(record.redirects) +
+                  ",\"received_bytes\":" + to_string(record.received) + "}\n";
+    }
+    else if (format_ == CSV) {
+        appendCSV(buffer, record.file);
+        buffer += ',' + to_string(record.line) + ',' + to_string(record.column) + ',';
+        appendCSV(buffer, record.URL);
+        buffer += ',';
+        appendCSV(buffer, record.finalURL);
+        buffer += ',' + record.status + ',' + to_string(record.httpCode) + ',' + to_string(record.curlCode) + ',';
+        appendCSV(buffer, record.error);
+        buffer += ',' + record.origin + ',' + to_string(record.elapsed) + ',' + millis(record.dns) + ',' +
+                  millis(record.connect) + ',' + millis(record.tls) + ',' + millis(record.firstByte) + ',' +
+                  millis(record.total) + ',' + to_string(record.redirects) + ',' + to_string(record.received) + '\n';
+    }
+    else {
+        if (record.status == "good") return;
+        const bool unreachable = record.status == "unreachable";
+
+        if (written > 0) buffer += ",\n";
+        buffer += string("{\"ruleId\":\"") + (unreachable ? "unreachable-host" : "dead-link") +
+                  "\",\"level\":\"" + (unreachable ? "warning" : "error") + "\",\"message\":{\"text\":";
+        appendJSON(buffer, "Dead link \"" + record.URL + "\" (" + record.error + ")");
+        buffer += "},\"locations\":[{\"physicalLocation\":{\"artifactLocation\":{\"uri\":";
+        appendJSON(buffer, record.file);
+        buffer += "},\"region\":{\"startLine\":" + to_string(record.line) +
+                  ",\"startColumn\":" + to_string(record.column) + "}}}],\"properties\":{\"url\":";
+        appendJSON(buffer, record.URL);
+        buffer += ",\"finalUrl\":";
+        appendJSON(buffer, record.finalURL);
+        buffer += ",\"httpCode\":" + to_string(record.httpCode) + ",\"curlCode\":" + to_string(record.curlCode) +
+                  ",\"origin\":";
+        appendJSON(buffer, record.origin);
+        buffer += ",\"elapsedMs\":" + to_string(record.elapsed) + "}}";
+    }
+    written++;
+}
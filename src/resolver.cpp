@@ -0,0 +1,90 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#include <resolver.h>
+
+#include <algorithm>
+
+#ifdef WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+#else
+    #include <sys/types.h>
+    #include <sys/socket.h>
+    #include <netdb.h>
+    #include <arpa/inet.h>
+#endif
+
+HostResolver::HostResolver(unsigned threads, bool ipv6) :
+    ipv6(ipv6),
+    pool(max(threads, 1u))
+{
+}
+
+void HostResolver::resolve(const string &host)
+{
+    requested++;
+    pool.submit([this, host] {
+        Answer answer = lookup(host, ipv6);
+        {
+            lock_guard<mutex> guard(answersLock);
+            ready.push_back(move(answer));
+        }
+        if (notifier) notifier();
+    });
+}
+
+void HostResolver::collect(vector<Answer> &answers)
+{
+    lock_guard<mutex> guard(answersLock);
+    collected += ready.size();
+    for (auto &answer: ready) answers.push_back(move(answer));
+    ready.clear();
+}
+
+//Same address family libcurl is told to use, see CURLOPT_IPRESOLVE in LinkChecker::setupHandle()
+HostResolver::Answer HostResolver::lookup(const string &host, bool ipv6)
+{
+    Answer answer;
+    answer.host = host;
+
+    addrinfo hints{};
+    hints.ai_family   = ipv6 ? AF_INET6 : AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo *found = nullptr;
+    const int status = getaddrinfo(host.c_str(), nullptr, &hints, &found);
+    if (status != 0) {
+        //Only a definitive "no such host" is trusted, anything else is left to libcurl
+        answer.status = status == EAI_NONAME ? Answer::NotFound : Answer::Failed;
+        return answer;
+    }
+
+    for (addrinfo *address = found; address; address = address->ai_next) {
+        char text[INET6_ADDRSTRLEN] = {};
+        const void *raw = address->ai_family == AF_INET6
+                        ? static_cast<const void*>(&reinterpret_cast<sockaddr_in6*>(address->ai_addr)->sin6_addr)
+                        : static_cast<const void*>(&reinterpret_cast<sockaddr_in*>(address->ai_addr)->sin_addr);
+        if (!inet_ntop(address->ai_family, raw, text, sizeof(text))) continue;
+
+        const string numeric = address->ai_family == AF_INET6 ? "[" + string(text) + "]" : string(text);
+        if (find(answer.addresses.begin(), answer.addresses.end(), numeric) == answer.addresses.end())
+            answer.addresses.push_back(numeric);
+    }
+    freeaddrinfo(found);
+
+    answer.status = answer.addresses.empty() ? Answer::Failed : Answer::Resolved;
+    return answer;
+}
@@ -0,0 +1,178 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#include <resultcache.h>
+#include <filereader.h>
+#include <binaryio.h>
+
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+
+namespace {
+
+const char   magic[]    = "FUDCACHE1\n";
+const size_t magicSize  = sizeof(magic) - 1;
+
+/*
+Record layout, integers are stored in the machine's byte order:
+    uint32 size of the rest of the record
+    int64  checkedAt
+    int32  httpCode
+    uint8  isHTTP
+    uint16 lengths of: key, finalURL, etag, lastModified
+    the four strings, not terminated
+*/
+const size_t fixedSize = 8 + 4 + 1 + 2 * 4;
+
+//Header values can't be longer than a record field
+uint16_t clamp(const string &text) { return text.size() > 0xFFFF ? 0xFFFF : text.size(); }
+
+} //namespace
+
+
+ResultCache::ResultCache(const string &path, long ttl) : path(path), ttl(ttl)
+{
+    if (path.empty()) return; //Only kept in memory
+
+    const bool clean = load();
+    if (foreign) return; //Never overwrite something that isn't ours
+
+    //A damaged tail or too many outdated records: start a fresh log with the live entries
+    if (!clean && rewrite()) return;
+
+    log = fopen(path.c_str(), "ab");
+    if (log && ftell(log) == 0) fwrite(magic, 1, magicSize, log);
+}
+
+ResultCache::~ResultCache()
+{
+    if (log) fclose(log);
+}
+
+int64_t ResultCache::now()
+{
+    return time(nullptr);
+}
+
+bool ResultCache::load()
+{
+    if (!filesystem::exists(path)) return true;
+
+    const MappedFile file(path);
+    if (!file.isOpen()) {
+        foreign = true;
+        return false;
+    }
+    if (file.size() == 0) return true;
+    if (file.size() < magicSize || memcmp(file.data(), magic, magicSize) != 0) {
+        foreign = true;
+        return false;
+    }
+
+    const char *in  = file.data() + magicSize;
+    const char *end = file.data() + file.size();
+    size_t records = 0;
+    while ((size_t)(end - in) >= 4) {
+        const char *record = in;
+        const uint32_t size = binaryio::get<uint32_t>(record);
+        if (size < fixedSize || (size_t)(end - record) < size) break;
+
+        CachedResult result;
+        result.checkedAt = binaryio::get<int64_t>(record);
+        result.httpCode  = binaryio::get<int32_t>(record);
+        result.isHTTP    = binaryio::get<uint8_t>(record) != 0;
+        const uint16_t keyLength      = binaryio::get<uint16_t>(record);
+        const uint16_t finalLength    = binaryio::get<uint16_t>(record);
+        const uint16_t etagLength     = binaryio::get<uint16_t>(record);
+        const uint16_t modifiedLength = binaryio::get<uint16_t>(record);
+        if (fixedSize + keyLength + finalLength + etagLength + modifiedLength != size) break;
+
+        string key(record, keyLength);                   record += keyLength;
+        result.finalURL.assign(record, finalLength);     record += finalLength;
+        result.etag.assign(record, etagLength);          record += etagLength;
+        result.lastModified.assign(record, modifiedLength);
+
+        entries[move(key)] = move(result);
+        records++;
+        in += 4 + size;
+    }
+
+    return in == end && records <= entries.size() * 2 + 1024;
+}
+
+bool ResultCache::rewrite()
+{
+    const string temporary = path + ".tmp";
+    log = fopen(temporary.c_str(), "wb");
+    if (!log) return false;
+
+    fwrite(magic, 1, magicSize, log);
+    for (const auto &entry: entries) append(entry.first, entry.second);
+
+    const bool written = fclose(log) == 0;
+    log = nullptr;
+
+    error_code failed;
+    if (written) filesystem::rename(temporary, path, failed);
+    if (!written || failed) {
+        filesystem::remove(temporary, failed);
+        return false;
+    }
+
+    log = fopen(path.c_str(), "ab");
+    return log != nullptr;
+}
+
+const CachedResult *ResultCache::find(const string &key) const
+{
+    const auto found = entries.find(key);
+    return found != entries.end() ? &found->second : nullptr;
+}
+
+bool ResultCache::isFresh(const CachedResult &result) const
+{
+    return now() - result.checkedAt < ttl;
+}
+
+void ResultCache::store(const string &key, const CachedResult &result)
+{
+    entries[key] = result;
+    if (log) append(key, result);
+}
+
+void ResultCache::append(const string &key, const CachedResult &result)
+{
+    const uint16_t keyLength      = clamp(key);
+    const uint16_t finalLength    = clamp(result.finalURL);
+    const uint16_t etagLength     = clamp(result.etag);
+    const uint16_t modifiedLength = clamp(result.lastModified);
+
+    string record;
+    binaryio::put<uint32_t>(record, fixedSize + keyLength + finalLength + etagLength + modifiedLength);
+    binaryio::put<int64_t>(record, result.checkedAt);
+    binaryio::put<int32_t>(record, result.httpCode);
+    binaryio::put<uint8_t>(record, result.isHTTP);
+    binaryio::put<uint16_t>(record, keyLength);
+    binaryio::put<uint16_t>(record, finalLength);
+    binaryio::put<uint16_t>(record, etagLength);
+    binaryio::put<uint16_t>(record, modifiedLength);
+    record.append(key, 0, keyLength);
+    record.append(result.finalURL, 0, finalLength);
+    record.append(result.etag, 0, etagLength);
+    record.append(result.lastModified, 0, modifiedLength);
+
+    fwrite(record.data(), 1, record.size(), log);
+}
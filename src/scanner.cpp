@@ -0,0 +1,139 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#include <scanner.h>
+#include <prefilter.h>
+
+namespace {
+
+enum CharClass : unsigned char {
+    HOST = 0x01, //[\w_-]     Host labels
+    BODY = 0x02, //[\w.,@?^=%&:/~+#-]  Anything after the host
+    LAST = 0x04  //[\w@?^=%&/~+#-]     Allowed as the last character
+};
+
+struct CharTable
+{
+    unsigned char classes[256] = {};
+
+    constexpr CharTable()
+    {
+        for (int c = 'a'; c <= 'z'; c++) classes[c] = HOST | BODY | LAST;
+        for (int c = 'A'; c <= 'Z'; c++) classes[c] = HOST | BODY | LAST;
+        for (int c = '0'; c <= '9'; c++) classes[c] = HOST | BODY | LAST;
+        classes['_'] = HOST | BODY | LAST;
+        classes['-'] = HOST | BODY | LAST;
+
+        const char tail[] = "@?^=%&/~+#";
+        for (const char *c = tail; *c; c++) classes[(unsigned char)*c] = BODY | LAST;
+
+        classes['.'] = BODY;
+        classes[','] = BODY;
+        classes[':'] = BODY;
+    }
+};
+
+constexpr CharTable table;
+
+inline bool is(char c, CharClass cls) { return table.classes[(unsigned char)c] & cls; }
+
+inline char lower(char c) { return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c; }
+
+//Case insensitive compare against a lower case literal
+inline bool startsWith(const char *p, const char *end, const char *literal, size_t length)
+{
+    if ((size_t)(end - p) < length) return false;
+    for (size_t i = 0; i < length; i++) {
+        if (lower(p[i]) != literal[i]) return false;
+    }
+    return true;
+}
+
+} //namespace
+
+
+size_t URLScanner::prefixLength(const char *p, const char *end)
+{
+    switch (lower(*p)) {
+    case 'h':
+        if (startsWith(p, end, "http://", 7)) return 7;
+        if (startsWith(p, end, "https://", 8)) return 8;
+        return 0;
+    case 'f':
+        return startsWith(p, end, "ftp://", 6) ? 6 : 0;
+    case 'w':
+        return startsWith(p, end, "www.", 4) ? 4 : 0;
+    default:
+        return 0;
+    }
+}
+
+size_t URLScanner::matchAt(const char *p, const char *end)
+{
+    const size_t prefix = prefixLength(p, end);
+    if (prefix == 0) return 0;
+
+    //Host: one label followed by at least one ".label", both greedy
+    const char *c = p + prefix;
+    const char *labelStart = c;
+    while (c < end && is(*c, HOST)) c++;
+    if (c == labelStart) return 0;
+
+    int labels = 0;
+    while (c + 1 < end && *c == '.' && is(c[1], HOST)) {
+        c += 2;
+        while (c < end && is(*c, HOST)) c++;
+        labels++;
+    }
+    if (labels == 0) return 0;
+
+    //Path, query...etc: the longest run of allowed characters
+    //that ends with a character which can finish a URL
+    const char *last = c;
+    while (c < end && is(*c, BODY)) {
+        if (is(*c, LAST)) last = c + 1;
+        c++;
+    }
+    return last - p;
+}
+
+bool URLScanner::find(const char *text, size_t size, size_t from, URLMatch &match)
+{
+    const char *end = text + size;
+    size_t candidate = AnchorFilter::next(text, size, from);
+    while (candidate < size) {
+        //"www." starts where it was found, the other prefixes end with ":/"
+        //and start 3 (ftp), 4 (http) or 5 (https) characters before it.
+        size_t first = candidate, last = candidate;
+        if (text[candidate] == ':') {
+            if (candidate < from + 3) { //No room for a prefix after "from"
+                candidate = AnchorFilter::next(text, size, candidate + 1);
+                continue;
+            }
+            last  = candidate - 3;
+            first = candidate >= from + 5 ? candidate - 5 : from;
+        }
+        for (size_t start = first; start <= last; start++) {
+            const size_t length = matchAt(text + start, end);
+            if (length > 0) {
+                match.offset = start;
+                match.length = length;
+                return true;
+            }
+        }
+        candidate = AnchorFilter::next(text, size, candidate + 1);
+    }
+    return false;
+}
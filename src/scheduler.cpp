@@ -0,0 +1,158 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#include <scheduler.h>
+
+#include <algorithm>
+
+HostScheduler::HostScheduler(int perHost, double rate, int threshold, bool probe) :
+    perHost(max(perHost, 1)),
+    interval(rate > 0 ? chrono::duration_cast<clock::duration>(chrono::duration<double>(1.0 / rate))
+                      : clock::duration::zero()),
+    threshold(max(threshold, 0)),
+    probe(probe)
+{
+}
+
+void HostScheduler::enqueue(Host &host, URLIndex::Entry *entry, bool front)
+{
+    waitingCount++;
+    if (host.breaker == Host::Open) {
+        unreachable.push_back(entry);
+        host.skipped++;
+        return;
+    }
+
+    if (front) host.waiting.push_front(entry);
+    else host.waiting.push_back(entry);
+    if (!host.inRotation) {
+        host.inRotation = true;
+        rotation.push_back(&host);
+    }
+}
+
+void HostScheduler::add(URLIndex::Entry *entry)
+{
+    enqueue(hosts[key(*entry)], entry, false);
+}
+
+void HostScheduler::retryLater(URLIndex::Entry *entry, long delayMs)
+{
+    Host &host = hosts[key(*entry)];
+    host.nextStart = max(host.nextStart, clock::now() + chrono::milliseconds(delayMs));
+    enqueue(host, entry, true);
+}
+
+bool HostScheduler::canStart(const Host &host, clock::time_point now) const
+{
+    //A probe goes alone, once the requests started before the breaker tripped are done
+    if (host.breaker == Host::Probing) return host.inFlight == 0 && !host.probe && now >= host.nextStart;
+    return host.inFlight < perHost && now >= host.nextStart;
+}
+
+URLIndex::Entry *HostScheduler::next()
+{
+    const auto now = clock::now();
+
+    //Every host in the rotation gets one look at most
+    for (size_t turns = rotation.size(); turns > 0; turns--) {
+        Host *host = rotation.front();
+        rotation.pop_front();
+
+        if (!canStart(*host, now)) {
+            rotation.push_back(host);
+            continue;
+        }
+
+        URLIndex::Entry *entry = host->waiting.front();
+        host->waiting.pop_front();
+        waitingCount--;
+        host->inFlight++;
+        host->nextStart = now + interval;
+        if (host->breaker == Host::Probing) host->probe = entry;
+
+        if (host->waiting.empty()) host->inRotation = false;
+        else rotation.push_back(host);
+        return entry;
+    }
+    return nullptr;
+}
+
+void HostScheduler::finished(const URLIndex::Entry *entry, bool reachable)
+{
+    const auto found = hosts.find(key(*entry));
+    if (found == hosts.end()) return;
+    Host &host = found->second;
+    if (host.inFlight > 0) host.inFlight--;
+
+    const bool wasProbe = host.probe == entry;
+    if (wasProbe) host.probe = nullptr;
+
+    if (reachable) {
+        host.failures = 0;
+        if (host.breaker == Host::Probing) host.breaker = Host::Closed;
+        return;
+    }
+
+    host.failures++;
+    if (host.breaker == Host::Closed && threshold > 0 && host.failures >= threshold) {
+        if (probe) host.breaker = Host::Probing;
+        else trip(host);
+    }
+    else if (host.breaker == Host::Probing && wasProbe) trip(host);
+}
+
+//The host is given up, everything still waiting for it is moved out of the rotation
+void HostScheduler::trip(Host &host)
+{
+    host.breaker = Host::Open;
+    host.skipped += host.waiting.size();
+    unreachable.insert(unreachable.end(), host.waiting.begin(), host.waiting.end());
+    host.waiting.clear();
+
+    if (host.inRotation) {
+        rotation.erase(find(rotation.begin(), rotation.end(), &host));
+        host.inRotation = false;
+    }
+}
+
+void HostScheduler::takeUnreachable(vector<URLIndex::Entry*> &entries)
+{
+    waitingCount -= unreachable.size();
+    entries.insert(entries.end(), unreachable.begin(), unreachable.end());
+    unreachable.clear();
+}
+
+vector<HostScheduler::Tripped> HostScheduler::trippedHosts() const
+{
+    vector<Tripped> tripped;
+    for (const auto &host: hosts)
+        if (host.second.breaker == Host::Open) tripped.push_back({host.first, host.second.skipped});
+    sort(tripped.begin(), tripped.end(), [](const Tripped &a, const Tripped &b) { return a.host < b.host; });
+    return tripped;
+}
+
+long HostScheduler::msUntilNext(long limit) const
+{
+    const auto now = clock::now();
+    long wait = limit;
+    for (const Host *host: rotation) {
+        //Waits for a request to finish, not for time
+        if (host->inFlight >= perHost || (host->breaker == Host::Probing && host->inFlight > 0)) continue;
+        const long ms = chrono::ceil<chrono::milliseconds>(host->nextStart - now).count();
+        wait = min(wait, max(ms, 0L));
+    }
+    return wait;
+}
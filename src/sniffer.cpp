@@ -0,0 +1,197 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#include <sniffer.h>
+#include <utf8.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace {
+
+struct Signature
+{
+    size_t      offset;
+    const char *bytes;
+    size_t      length;
+    const char *name;
+};
+
+//Formats where the URL scanner would only find garbage
+const Signature signatures[] = {
+    {0,   "\x89PNG\r\n\x1a\n",    8, "PNG image"},
+    {0,   "GIF87a",                 6, "GIF image"},
+    {0,   "GIF89a",                 6, "GIF image"},
+    {0,   "\xff\xd8\xff",           3, "JPEG image"},
+    {0,   "BM",                     2, nullptr}, //Plain text can start like these, see magic()
+    {0,   "%PDF-",                  5, "PDF document"},
+    {0,   "\x7f" "ELF",              4, "ELF executable"},
+    {0,   "MZ",                     2, nullptr},
+    {0,   "\xca\xfe\xba\xbe",        4, "Mach-O/Java class"},
+    {0,   "\xcf\xfa\xed\xfe",        4, "Mach-O executable"},
+    {0,   "\xce\xfa\xed\xfe",        4, "Mach-O executable"},
+    {0,   "\0asm",                  4, "WebAssembly module"},
+    {0,   "PK\x03\x04",              4, "ZIP archive"},
+    {0,   "\x1f\x8b",                2, "gzip archive"},
+    {0,   "BZh",                    3, nullptr},
+    {0,   "\xfd" "7zXZ\0",           6, "xz archive"},
+    {0,   "7z\xbc\xaf\x27\x1c",      6, "7z archive"},
+    {0,   "Rar!\x1a\x07",            6, "RAR archive"},
+    {0,   "\x28\xb5\x2f\xfd",        4, "zstd archive"},
+    {257, "ustar",                  5, "tar archive"},
+    {0,   "SQLite format 3\0",     16, "SQLite database"},
+    {0,   "OggS",                   4, nullptr},
+    {0,   "fLaC",                   4, nullptr},
+    {0,   "ID3",                    3, nullptr},
+    {4,   "ftyp",                   4, "MP4 media"},
+    {0,   "\x1a\x45\xdf\xa3",        4, "Matroska/WebM media"},
+    {0,   "wOFF",                   4, nullptr},
+    {0,   "wOF2",                   4, nullptr},
+    {0,   "\0\x01\0\0",              4, "TrueType font"},
+    {0,   "OTTO",                   4, nullptr},
+};
+
+//Length of the UTF-8 sequence at "at", 0 when it's invalid. A sequence cut by the end
+//of the block is accepted since the file goes on after it.
+size_t utf8Length(const unsigned char *at, const unsigned char *end)
+{
+    const unsigned char lead = *at;
+    size_t length;
+    if (lead < 0x80) return 1;
+    else if (lead >= 0xc2 && lead <= 0xdf) length = 2;
+    else if (lead >= 0xe0 && lead <= 0xef) length = 3;
+    else if (lead >= 0xf0 && lead <= 0xf4) length = 4;
+    else return 0;
+
+    for (size_t i = 1; i < length; i++) {
+        if (at + i >= end) return end - at;
+        if ((at[i] & 0xc0) != 0x80) return 0;
+    }
+    return length;
+}
+
+} //namespace
+
+
+const char *ContentSniffer::magic(const unsigned char *data, size_t size)
+{
+    for (const auto &signature: signatures) {
+        if (size < signature.offset + signature.length) continue;
+        if (memcmp(data + signature.offset, signature.bytes, signature.length) != 0) continue;
+        if (signature.name) return signature.name;
+
+        //A few letters are common at the start of a text, these need more evidence
+        const string_view bytes(signature.bytes, signature.length);
+        if (bytes == "MZ" && size >= 64) {
+            uint32_t header = 0;
+            memcpy(&header, data + 60, 4);
+            //In size_t, a header close to 4 GiB would wrap around in 32 bits
+            if (size_t(header) + 4 <= size && memcmp(data + header, "PE\0\0", 4) == 0) return "Windows executable";
+        }
+        else if (bytes == "BM" && size >= 14 && data[6] == 0 && data[7] == 0 && data[8] == 0 && data[9] == 0)
+            return "BMP image";
+        //Block size digit, then the magic of the first block
+        else if (bytes == "BZh" && size >= 10 && data[3] >= '1' && data[3] <= '9' &&
+                 memcmp(data + 4, "\x31\x41\x59\x26\x53\x59", 6) == 0)
+            return "bzip2 archive";
+        //ID3v2.2 to 2.4, flags without their unused bits, a size of four 7-bit bytes
+        else if (bytes == "ID3" && size >= 10 && data[3] >= 2 && data[3] <= 4 && data[4] != 0xff && (data[5] & 0x0f) == 0 &&
+                 ((data[6] | data[7] | data[8] | data[9]) & 0x80) == 0)
+            return "MP3 audio";
+        //Stream structure version 0 and a header type of three bits
+        else if (bytes == "OggS" && size >= 27 && data[4] == 0 && data[5] <= 7) return "Ogg media";
+        //The first metadata block is STREAMINFO, 34 bytes long
+        else if (bytes == "fLaC" && size >= 8 && (data[4] & 0x7f) == 0 && data[5] == 0 && data[6] == 0 && data[7] == 34)
+            return "FLAC audio";
+        //Flavor of the wrapped font
+        else if ((bytes == "wOFF" || bytes == "wOF2") && size >= 8 &&
+                 (memcmp(data + 4, "\0\x01\0\0", 4) == 0 || memcmp(data + 4, "OTTO", 4) == 0 || memcmp(data + 4, "true", 4) == 0))
+            return bytes == "wOFF" ? "WOFF font" : "WOFF2 font";
+        //Big-endian table count, a font has a few dozen at most
+        else if (bytes == "OTTO" && size >= 12 && data[4] == 0 && data[5] >= 1 && data[5] <= 64) return "OpenType font";
+    }
+    return nullptr;
+}
+
+ContentSniffer::Kind ContentSniffer::sniff(const char *data, size_t size, string &what)
+{
+    const unsigned char *block = reinterpret_cast<const unsigned char*>(data);
+    const size_t length = min(size, blockSize);
+    what.clear();
+
+    if (length >= 2 && block[0] == 0xff && block[1] == 0xfe) return UTF16LE;
+    if (length >= 2 && block[0] == 0xfe && block[1] == 0xff) return UTF16BE;
+
+    if (const char *format = magic(block, length)) {
+        what = format;
+        return Binary;
+    }
+
+    //UTF-16 without a mark: mostly ASCII text has a zero in every other byte
+    size_t evenZeros = 0, oddZeros = 0;
+    for (size_t i = 0; i + 1 < length; i += 2) {
+        evenZeros += block[i] == 0;
+        oddZeros  += block[i + 1] == 0;
+    }
+    const size_t pairs = length / 2;
+    if (pairs >= 8) {
+        if (oddZeros * 10 >= pairs * 9 && evenZeros * 10 < pairs) return UTF16LE;
+        if (evenZeros * 10 >= pairs * 9 && oddZeros * 10 < pairs) return UTF16BE;
+    }
+    if (evenZeros + oddZeros > 0 || (length % 2 && block[length - 1] == 0)) return Binary;
+
+    //Text can have a few stray bytes (Latin-1 accents for example), binaries have plenty
+    size_t suspicious = 0;
+    const unsigned char *end = block + length;
+    for (const unsigned char *at = block; at < end;) {
+        const size_t sequence = utf8Length(at, end);
+        if (sequence == 0) {
+            suspicious++;
+            at++;
+            continue;
+        }
+        if (*at < 0x20 && *at != '\t' && *at != '\n' && *at != '\r' && *at != '\f' && *at != '\v' && *at != 0x1b)
+            suspicious++;
+        at += sequence;
+    }
+    return suspicious * 10 > length ? Binary : Text;
+}
+
+string ContentSniffer::toUTF8(const char *data, size_t size, Kind kind)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char*>(data);
+    const bool little = kind == UTF16LE;
+    const auto unit = [&](size_t i) -> unsigned long {
+        return little ? bytes[i] | bytes[i + 1] << 8 : bytes[i] << 8 | bytes[i + 1];
+    };
+
+    string out;
+    out.reserve(size / 2 + size / 8);
+
+    size_t i = 0;
+    if (size >= 2 && unit(0) == 0xfeff) i = 2;
+    for (; i + 1 < size; i += 2) {
+        unsigned long code = unit(i);
+        if (code >= 0xd800 && code <= 0xdbff && i + 3 < size && unit(i + 2) >= 0xdc00 && unit(i + 2) <= 0xdfff) {
+            code = 0x10000 + ((code - 0xd800) << 10) + (unit(i + 2) - 0xdc00);
+            i += 2;
+        }
+        else if (code >= 0xd800 && code <= 0xdfff) code = 0xfffd;
+        appendUTF8(out, code);
+    }
+    return out;
+}
@@ -0,0 +1,74 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#include <stringpool.h>
+
+#include <cstring>
+#include <functional>
+
+namespace {
+    //Characters are stored in blocks of this size, longer strings get a block of their own
+    const size_t blockSize = 64 << 10;
+}
+
+uint32_t StringPool::intern(string_view text)
+{
+    if ((strings.size() + 1) * 2 > slots.size()) grow();
+
+    const size_t mask = slots.size() - 1;
+    for (size_t slot = hash<string_view>()(text) & mask; ; slot = (slot + 1) & mask) {
+        if (slots[slot] == 0) {
+            strings.push_back(store(text));
+            slots[slot] = strings.size();
+            return strings.size() - 1;
+        }
+        if (strings[slots[slot] - 1] == text) return slots[slot] - 1;
+    }
+}
+
+string_view StringPool::store(string_view text)
+{
+    const size_t length = text.size() + 1;
+    char *place;
+    if (length > blockSize / 4) {
+        blocks.emplace_back(new char[length]);
+        place = blocks.back().get();
+    }
+    else {
+        if (length > left) {
+            blocks.emplace_back(new char[blockSize]);
+            next = blocks.back().get();
+            left = blockSize;
+        }
+        place = next;
+        next += length;
+        left -= length;
+    }
+    memcpy(place, text.data(), text.size());
+    place[text.size()] = '\0';
+    return string_view(place, text.size());
+}
+
+void StringPool::grow()
+{
+    vector<uint32_t> bigger(max<size_t>(slots.size() * 2, 1024));
+    const size_t mask = bigger.size() - 1;
+    for (size_t id = 0; id < strings.size(); id++) {
+        size_t slot = hash<string_view>()(strings[id]) & mask;
+        while (bigger[slot] != 0) slot = (slot + 1) & mask;
+        bigger[slot] = id + 1;
+    }
+    slots.swap(bigger);
+}
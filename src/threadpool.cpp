@@ -0,0 +1,118 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#include <threadpool.h>
+
+namespace {
+    //Which pool and queue the current thread works for, if any
+    thread_local const void *currentPool  = nullptr;
+    thread_local size_t      currentQueue = 0;
+}
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+    if (threads < 1) threads = 1;
+    for (unsigned i = 0; i < threads; i++) queues.push_back(make_unique<Queue>());
+    for (unsigned i = 0; i < threads; i++) workers.emplace_back(&ThreadPool::work, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> guard(stateLock);
+        stopping = true;
+    }
+    taskAdded.notify_all();
+    for (auto &worker: workers) worker.join();
+}
+
+unsigned ThreadPool::defaultThreads()
+{
+    const unsigned hardware = thread::hardware_concurrency();
+    return hardware ? hardware : 4;
+}
+
+void ThreadPool::submit(function<void()> task)
+{
+    const size_t index = currentPool == this ? currentQueue : nextQueue++ % queues.size();
+    {
+        lock_guard<mutex> guard(queues[index]->lock);
+        queues[index]->tasks.push_back(move(task));
+    }
+    {
+        lock_guard<mutex> guard(stateLock);
+        queued++;
+        unfinished++;
+    }
+    taskAdded.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    unique_lock<mutex> guard(stateLock);
+    allDone.wait(guard, [this] { return unfinished == 0; });
+}
+
+bool ThreadPool::take(size_t index, function<void()> &task)
+{
+    //Own queue first, newest task (it's likely still in the cache)
+    {
+        Queue &own = *queues[index];
+        lock_guard<mutex> guard(own.lock);
+        if (!own.tasks.empty()) {
+            task = move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    //Then steal the oldest task of another worker
+    for (size_t i = 1; i < queues.size(); i++) {
+        Queue &other = *queues[(index + i) % queues.size()];
+        lock_guard<mutex> guard(other.lock);
+        if (!other.tasks.empty()) {
+            task = move(other.tasks.front());
+            other.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::work(size_t index)
+{
+    currentPool  = this;
+    currentQueue = index;
+
+    while (true) {
+        {
+            unique_lock<mutex> guard(stateLock);
+            taskAdded.wait(guard, [this] { return stopping || queued > 0; });
+            if (queued == 0) return; //Stopping and nothing left
+            queued--;
+        }
+
+        //A task is reserved for us, it's in one of the queues
+        function<void()> task;
+        while (!take(index, task)) this_thread::yield();
+        task();
+
+        bool last;
+        {
+            lock_guard<mutex> guard(stateLock);
+            last = --unfinished == 0;
+        }
+        if (last) allDone.notify_all();
+    }
+}
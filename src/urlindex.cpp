@@ -0,0 +1,129 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#include <urlindex.h>
+
+#include <algorithm>
+
+namespace {
+    void toLower(string &text)
+    {
+        for (auto &c: text) {
+            if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+        }
+    }
+}
+
+long URLParts::defaultPort(const string &scheme)
+{
+    if (scheme == "http")  return 80;
+    if (scheme == "https") return 443;
+    if (scheme == "ftp")   return 21;
+    return 0;
+}
+
+URLParts URLParts::parse(const string &URL)
+{
+    URLParts parts;
+
+    size_t authority = 0;
+    const size_t schemeEnd = URL.find("://");
+    if (schemeEnd != string::npos) {
+        parts.scheme = URL.substr(0, schemeEnd);
+        toLower(parts.scheme);
+        authority = schemeEnd + 3;
+    }
+    else parts.scheme = "http"; //"www." URLs, libcurl guesses the same
+
+    const size_t authorityEnd = min(URL.find_first_of("/?#", authority), URL.size());
+    string hostPort = URL.substr(authority, authorityEnd - authority);
+
+    const size_t at = hostPort.rfind('@');
+    if (at != string::npos) {
+        parts.userInfo = hostPort.substr(0, at);
+        hostPort.erase(0, at + 1);
+    }
+
+    //A bracketed IPv6 host has colons of its own, its port can only come after the ']'
+    const size_t bracket = hostPort.compare(0, 1, "[") == 0 ? hostPort.find("]:") : string::npos;
+    const size_t colon = hostPort.compare(0, 1, "[") == 0 ? (bracket == string::npos ? bracket : bracket + 1)
+                                                          : hostPort.rfind(':');
+    if (colon != string::npos) {
+        //An empty port is the default one, anything but digits isn't a port at all
+        const string port = hostPort.substr(colon + 1);
+        if (port.size() < 6 && all_of(port.begin(), port.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            if (!port.empty()) parts.port = stol(port);
+            hostPort.erase(colon);
+        }
+    }
+    parts.host = hostPort;
+    toLower(parts.host);
+
+    const size_t fragment = min(URL.find('#', authorityEnd), URL.size());
+    const size_t queryStart = min(URL.find('?', authorityEnd), fragment);
+    parts.path  = URL.substr(authorityEnd, queryStart - authorityEnd);
+    parts.query = URL.substr(queryStart, fragment - queryStart);
+    parts.fragment = URL.substr(fragment);
+
+    return parts;
+}
+
+string URLIndex::normalize(const URLParts &parts)
+{
+    string key = parts.scheme + "://";
+    if (!parts.userInfo.empty()) key += parts.userInfo + "@";
+    key += parts.host;
+    if (parts.port != 0 && parts.port != URLParts::defaultPort(parts.scheme))
+        key += ":" + to_string(parts.port);
+
+    string path = parts.path;
+    while (!path.empty() && path.back() == '/') path.pop_back();
+    key += path;
+    key += parts.query;
+    if (parts.scheme == "file") key += parts.fragment;
+
+    return key;
+}
+
+pair<URLIndex::Entry*, bool> URLIndex::add(FoundLink &&link)
+{
+    totalOccurrences++;
+
+    const uint32_t spelling = pool.intern(link.URL);
+    const Occurrence occurrence{uint32_t(link.fileIndex), spelling, uint32_t(link.lineNum), uint32_t(link.position)};
+    //Written exactly like a URL seen before: same entry, no parsing
+    if (spelling < bySpelling.size() && bySpelling[spelling]) {
+        Entry *entry = bySpelling[spelling];
+        entry->occurrences.push_back(occurrence);
+        return {entry, false};
+    }
+
+    const URLParts parts = URLParts::parse(link.URL);
+    const string_view key = exact ? pool.at(spelling) : pool.at(pool.intern(normalize(parts)));
+    auto inserted = entries.try_emplace(key);
+    Entry &entry = inserted.first->second;
+    if (inserted.second) {
+        entry.URL  = pool.at(spelling);
+        entry.key  = key;
+        entry.host = parts.host;
+        entry.port = parts.port ? parts.port : URLParts::defaultPort(parts.scheme);
+    }
+    //Keys are in the pool too, so their ids get a slot that stays empty until they're seen as a spelling
+    bySpelling.resize(pool.size());
+    bySpelling[spelling] = &entry;
+    entry.occurrences.push_back(occurrence);
+
+    return {&entry, inserted.second};
+}
@@ -0,0 +1,240 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#include <walker.h>
+#include <threadpool.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+//The rules of one .gitignore, "base" is its directory relative to the root of the walk
+struct DirectoryWalker::IgnoreList
+{
+    shared_ptr<const IgnoreList> parent;
+    string base;
+    vector<GlobRule> rules;
+};
+
+struct DirectoryWalker::Node
+{
+    string path;
+    vector<string> files;
+    vector<pair<string, unique_ptr<Node>>> dirs;
+    vector<string> errors;
+};
+
+bool GlobRule::parse(string text, bool allowNegation, GlobRule &rule)
+{
+    rule = GlobRule();
+    while (!text.empty() && (text.back() == '\r' || text.back() == ' ')) text.pop_back();
+    if (text.empty() || text[0] == '#') return false;
+
+    if (allowNegation && text[0] == '!') {
+        rule.negate = true;
+        text.erase(0, 1);
+    }
+    if (!text.empty() && text.back() == '/') {
+        rule.dirOnly = true;
+        text.pop_back();
+    }
+    if (!text.empty() && text[0] == '/') {
+        rule.anchored = true;
+        text.erase(0, 1);
+    }
+    if (text.find('/') != string::npos) rule.anchored = true;
+
+    rule.pattern = move(text);
+    return !rule.pattern.empty();
+}
+
+bool GlobRule::matches(const string &relative, const string &name, bool isDir) const
+{
+    if (dirOnly && !isDir) return false;
+    return match(pattern.c_str(), anchored ? relative.c_str() : name.c_str());
+}
+
+bool GlobRule::match(const char *pattern, const char *text)
+{
+    while (*pattern) {
+        if (pattern[0] == '*' && pattern[1] == '*') {
+            pattern += 2;
+            if (*pattern == '/') {
+                //"**/" is zero or more whole directories
+                pattern++;
+                if (match(pattern, text)) return true;
+                for (; *text; text++)
+                    if (*text == '/' && match(pattern, text + 1)) return true;
+                return false;
+            }
+            for (;; text++) {
+                if (match(pattern, text)) return true;
+                if (!*text) return false;
+            }
+        }
+        if (*pattern == '*') {
+            pattern++;
+            for (;; text++) {
+                if (match(pattern, text)) return true;
+                if (!*text || *text == '/') return false;
+            }
+        }
+        if (!*text) return false;
+
+        if (*pattern == '?') {
+            if (*text == '/') return false;
+        }
+        else if (*pattern == '[' && strchr(pattern + 2, ']')) {
+            const char *p = pattern + 1;
+            const bool negated = *p == '!' || *p == '^';
+            if (negated) p++;
+
+            bool found = false;
+            const char *first = p;
+            for (; *p && (*p != ']' || p == first); p++) {
+                if (p[1] == '-' && p[2] && p[2] != ']') {
+                    found |= *text >= p[0] && *text <= p[2];
+                    p += 2;
+                }
+                else found |= *text == *p;
+            }
+            if (found == negated || *text == '/') return false;
+            pattern = p;
+        }
+        else {
+            if (*pattern == '\\' && pattern[1]) pattern++;
+            if (*pattern != *text) return false;
+        }
+        pattern++;
+        text++;
+    }
+    return !*text;
+}
+
+shared_ptr<const DirectoryWalker::IgnoreList> DirectoryWalker::readIgnoreFile(const string &path, const string &relative,
+                                                                              shared_ptr<const IgnoreList> parent)
+{
+    ifstream file(path);
+    if (!file) return parent;
+
+    auto ignores = make_shared<IgnoreList>();
+    ignores->parent = move(parent);
+    ignores->base   = relative;
+
+    string line;
+    GlobRule rule;
+    while (getline(file, line))
+        if (GlobRule::parse(line, true, rule)) ignores->rules.push_back(rule);
+
+    if (ignores->rules.empty()) return ignores->parent;
+    return ignores;
+}
+
+bool DirectoryWalker::excluded(const string &relative, const string &name, bool isDir,
+                               const shared_ptr<const IgnoreList> &ignores) const
+{
+    for (const auto &rule: options.exclude)
+        if (rule.matches(relative, name, isDir)) return true;
+
+    if (!ignores) return false;
+
+    //The deepest .gitignore wins, and inside one file the last matching rule
+    vector<const IgnoreList*> chain;
+    for (const IgnoreList *list = ignores.get(); list; list = list->parent.get()) chain.push_back(list);
+
+    bool ignored = false;
+    for (auto list = chain.rbegin(); list != chain.rend(); ++list) {
+        const string &base = (*list)->base;
+        const string inside = base.empty() ? relative : relative.substr(base.size() + 1);
+        for (const auto &rule: (*list)->rules)
+            if (rule.matches(inside, name, isDir)) ignored = !rule.negate;
+    }
+    return ignored;
+}
+
+void DirectoryWalker::list(const string &path, const string &relative, shared_ptr<const IgnoreList> ignores,
+                           Node &node, ThreadPool &pool) const
+{
+    node.path = path;
+    if (options.gitignore) ignores = readIgnoreFile((fs::path(path) / ".gitignore").string(), relative, move(ignores));
+
+    error_code failed;
+    fs::directory_iterator entries(path, failed);
+    if (failed) {
+        node.errors.push_back("Failed to read the directory \"" + path + "\": " + failed.message());
+        return;
+    }
+
+    for (const auto &entry: entries) {
+        const string name = entry.path().filename().string();
+        const string entryRelative = relative.empty() ? name : relative + '/' + name;
+
+        //Same as before: links to directories aren't followed, links to files are read
+        error_code statFailed;
+        const bool isLink = entry.is_symlink(statFailed);
+        const bool isDir  = !isLink && entry.is_directory(statFailed);
+        const bool isFile = !isDir && entry.is_regular_file(statFailed);
+        if (!isDir && !isFile) continue;
+
+        if (isDir && options.gitignore && name == ".git") continue;
+        if (excluded(entryRelative, name, isDir, ignores)) continue;
+
+        if (isFile) {
+            if (!options.include.empty() &&
+                none_of(options.include.begin(), options.include.end(),
+                        [&](const GlobRule &rule) { return rule.matches(entryRelative, name, false); }))
+                continue;
+            node.files.push_back(entry.path().string());
+        }
+        else if (options.recursive) node.dirs.push_back({name, make_unique<Node>()});
+    }
+
+    sort(node.files.begin(), node.files.end());
+    sort(node.dirs.begin(), node.dirs.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+
+    for (auto &dir: node.dirs) {
+        pool.submit([this, &pool, path = (fs::path(path) / dir.first).string(),
+                     relative = relative.empty() ? dir.first : relative + '/' + dir.first,
+                     ignores, &child = *dir.second] {
+            list(path, relative, ignores, child, pool);
+        });
+    }
+}
+
+void DirectoryWalker::walk(const string &root, vector<string> &files, vector<string> &errors,
+                           vector<string> *directories) const
+{
+    Node top;
+    {
+        ThreadPool pool(max(options.threads, 1u));
+        pool.submit([this, &root, &top, &pool] { list(root, "", nullptr, top, pool); });
+        pool.wait();
+    }
+
+    //Depth first, in the same order the directories were sorted
+    vector<const Node*> pending{&top};
+    while (!pending.empty()) {
+        const Node *node = pending.back();
+        pending.pop_back();
+
+        files.insert(files.end(), node->files.begin(), node->files.end());
+        errors.insert(errors.end(), node->errors.begin(), node->errors.end());
+        if (directories) directories->push_back(node->path);
+        for (auto dir = node->dirs.rbegin(); dir != node->dirs.rend(); ++dir) pending.push_back(dir->second.get());
+    }
+}
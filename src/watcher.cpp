@@ -0,0 +1,291 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+#include <watcher.h>
+#include <checker.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+
+#ifdef __linux__
+    #include <poll.h>
+    #include <sys/eventfd.h>
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#endif
+
+namespace fs = filesystem;
+
+namespace {
+    //Events closer than this are one burst (an editor saving, a checkout...), in milliseconds
+    const int quietPeriod = 100;
+    //A burst that never ends is scanned anyway after this, in milliseconds
+    const long maxDelay = 1000;
+}
+
+Watcher::Watcher(const ScanOptions &options, const WalkOptions &walkOptions) :
+    options(options),
+    walkOptions(walkOptions),
+    scanner(options),
+    results(options.cachePath, options.cacheTTL)
+{
+    for (const string &path: {options.cachePath, options.manifestPath, options.metricsPath,
+                              ReportWriter::toStandardOutput(options.reportPath) ? string() : options.reportPath})
+        if (!path.empty()) own.insert(absolute(path));
+    mergedReport = !options.reportFormat.empty() && !ReportWriter::toStandardOutput(options.reportPath);
+
+#ifdef __linux__
+    notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+}
+
+Watcher::~Watcher()
+{
+#ifdef __linux__
+    if (notify >= 0) close(notify);
+    if (wakeup >= 0) close(wakeup);
+#endif
+}
+
+void Watcher::stop()
+{
+#ifdef __linux__
+    const uint64_t one = 1;
+    if (wakeup >= 0 && write(wakeup, &one, sizeof(one)) < 0) {}
+#endif
+}
+
+string Watcher::absolute(const string &path)
+{
+    error_code failed;
+    const fs::path full = fs::absolute(path, failed);
+    return failed ? path : full.lexically_normal().string();
+}
+
+void Watcher::addDirectory(const string &path, const ScanCallbacks &callbacks)
+{
+#ifdef __linux__
+    //Files are written then closed, or written elsewhere and moved here. New directories
+    //are walked, their files are only there once they're closed.
+    const int wd = inotify_add_watch(notify, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_ONLYDIR);
+    if (wd >= 0) watches[wd] = path;
+    else if (errno == ENOSPC && !limitReached) {
+        limitReached = true;
+        reportProblem(options, callbacks, "Too many directories to watch, raise fs.inotify.max_user_watches. "
+                                          "Some changes won't be seen.\n", warn);
+    }
+#endif
+}
+
+//Walks the directories again, files that weren't there before go to "added"
+void Watcher::walk(const ScanCallbacks &callbacks, unordered_set<string> &added)
+{
+    const DirectoryWalker walker(walkOptions);
+    for (const auto &root: roots) {
+        vector<string> files, errors, directories;
+        walker.walk(root, files, errors, &directories);
+        for (const auto &directory: directories) addDirectory(absolute(directory), callbacks);
+        for (auto &file: files) {
+            const string path = absolute(file);
+            if (own.count(path) || known.count(path)) continue;
+            known.emplace(path, move(file));
+            added.insert(path);
+        }
+    }
+}
+
+void Watcher::readEvents(unordered_set<string> &changed, bool &rewalk, bool &overflow)
+{
+#ifdef __linux__
+    alignas(inotify_event) char buffer[64 * 1024];
+    while (true) {
+        const ssize_t length = read(notify, buffer, sizeof(buffer));
+        if (length <= 0) return;
+
+        for (ssize_t offset = 0; offset < length; ) {
+            const inotify_event *event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                overflow = true;
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                watches.erase(event->wd); //The directory is gone
+                continue;
+            }
+            const auto directory = watches.find(event->wd);
+            if (directory == watches.end() || event->len == 0) continue;
+
+            //A new directory may come with files, a new file is only there once it's closed
+            if (event->mask & IN_ISDIR) {
+                rewalk = walkOptions.recursive;
+                continue;
+            }
+            if (event->mask & IN_CREATE) continue;
+
+            const string path = (fs::path(directory->second) / event->name).string();
+            if (own.count(path)) continue;
+            if (known.count(path)) changed.insert(path);
+            else if (!(event->mask & (IN_DELETE | IN_MOVED_FROM))) rewalk = true; //Might be one of ours, the walk knows
+        }
+    }
+#endif
+}
+
+bool Watcher::wait(unordered_set<string> &changed, bool &rewalk)
+{
+#ifdef __linux__
+    pollfd fds[2] = {{notify, POLLIN, 0}, {wakeup, POLLIN, 0}};
+    bool overflow = false;
+    timer burst;
+    int timeout = -1; //Nothing happened yet
+
+    while (true) {
+        fds[0].revents = fds[1].revents = 0;
+        const int ready = poll(fds, 2, timeout);
+        if (ready < 0 && errno != EINTR) return false;
+        if (fds[1].revents & POLLIN) return false;
+        if (ready == 0) break; //Calm again
+
+        if (fds[0].revents & POLLIN) {
+            if (timeout < 0) burst.restart();
+            readEvents(changed, rewalk, overflow);
+        }
+        if (changed.empty() && !rewalk && !overflow) continue;
+
+        const long left = maxDelay - burst.getTimeElapsed();
+        if (left <= 0) break;
+        timeout = (int)min<long>(quietPeriod, left);
+    }
+
+    //Events were lost, everything may have changed
+    if (overflow) {
+        for (const auto &file: known) changed.insert(file.first);
+        rewalk = !roots.empty();
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+//The records of "file" and of its archive members, before it's scanned again or once it's gone
+void Watcher::forget(const string &file)
+{
+    records.erase(file);
+    const string members = file + "!/";
+    auto record = records.lower_bound(members);
+    while (record != records.end() && record->first.compare(0, members.size(), members) == 0) record = records.erase(record);
+}
+
+void Watcher::writeReport(const ScanCallbacks &callbacks)
+{
+    ReportWriter::Format format = ReportWriter::JsonLines;
+    ReportWriter::parseFormat(options.reportFormat, format);
+    ReportWriter report(format, options.reportPath);
+    if (!report.isOpen()) {
+        reportProblem(options, callbacks, "Failed to open the report \"" + options.reportPath + "\", no report will be written.\n", error);
+        return;
+    }
+    for (const auto &file: records) {
+        for (auto record: file.second) report.write(move(record));
+    }
+    if (!report.close())
+        reportProblem(options, callbacks, "Failed to write the whole report \"" + options.reportPath + "\".\n", error);
+}
+
+bool Watcher::watch(const vector<string> &files, const vector<string> &directories, const ScanCallbacks &callbacks)
+{
+#ifdef __linux__
+    if (notify < 0 || wakeup < 0) {
+        reportProblem(options, callbacks, "Failed to watch the files: " + string(strerror(errno)) + ".\n", error);
+        return false;
+    }
+
+    for (const auto &file: files) {
+        const string path = absolute(file);
+        known.emplace(path, file);
+        addDirectory(fs::path(path).parent_path().string(), callbacks);
+    }
+    roots = directories;
+    unordered_set<string> added;
+    walk(callbacks, added); //Only for the directories, the files are the ones given
+
+    //The report file is written by writeReport(), from the records collected here
+    ScanOptions first = options;
+    ScanCallbacks scanCallbacks = callbacks;
+    if (mergedReport) {
+        first.reportFormat.clear();
+        scanCallbacks.link = [this, &callbacks](const ReportRecord &record) {
+            if (callbacks.link) callbacks.link(record);
+            records[record.file].push_back(record);
+        };
+    }
+
+    //The manifest is rewritten with the files of each scan, only the first one has them all
+    scanner.scan(files, first, scanCallbacks, &results);
+    if (mergedReport) writeReport(callbacks);
+    ScanOptions rescan = first;
+    rescan.manifestPath.clear();
+
+    if (options.console)
+        cout << "Watching " << known.size() << " file(s) in " << watches.size() << " directory(ies), press Ctrl+C to stop..." << endl;
+
+    unordered_set<string> changed;
+    bool rewalk = false;
+    while (wait(changed, rewalk)) {
+        if (rewalk) walk(callbacks, changed);
+
+        vector<string> paths;
+        bool removed = false;
+        for (const auto &path: changed) {
+            error_code failed;
+            if (fs::is_regular_file(path, failed)) paths.push_back(known.at(path));
+            else if (mergedReport && records.count(known.at(path))) {
+                forget(known.at(path));
+                removed = true;
+            }
+        }
+        changed.clear();
+        rewalk = false;
+        if (paths.empty()) {
+            if (removed) writeReport(callbacks);
+            continue;
+        }
+        sort(paths.begin(), paths.end());
+
+        if (options.console) {
+            cout << '\n' << paths.size() << " file(s) changed";
+            if (paths.size() == 1) cout << ": \"" << paths.front() << '"';
+            cout << '\n';
+        }
+        if (mergedReport) {
+            for (const auto &path: paths) forget(path);
+        }
+        scanner.scan(paths, rescan, scanCallbacks, &results);
+        if (mergedReport) writeReport(callbacks);
+        if (options.console) cout.flush(); //Whoever reads the output is waiting for it
+    }
+    if (options.console) cout << "Stopped watching.\n";
+    return true;
+#else
+    reportProblem(options, callbacks, "Watching files needs inotify, it's only available on Linux.\n", error);
+    return false;
+#endif
+}
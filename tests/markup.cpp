@@ -0,0 +1,74 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+/*
+Links MarkupScanner finds in Markdown and HTML: every target, once, in the order of the text,
+and nothing taken from text that only looks like markup. Run by ctest.
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <markup.h>
+
+using namespace std;
+
+namespace {
+    size_t failures = 0;
+
+    void finds(const string &what, const string &text, MarkupScanner::Kind kind, const vector<string> &expected)
+    {
+        vector<MarkupScanner::Link> links;
+        string base;
+        MarkupScanner::links(text.data(), text.size(), kind, links, base);
+
+        vector<string> targets;
+        for (const auto &link: links) targets.push_back(link.target);
+        if (targets == expected) return;
+
+        failures++;
+        cerr << "FAILED: " << what << ", found";
+        for (const auto &target: targets) cerr << " \"" << target << "\"";
+        cerr << ", expected";
+        for (const auto &target: expected) cerr << " \"" << target << "\"";
+        cerr << '\n';
+    }
+}
+
+int main()
+{
+    const MarkupScanner::Kind md = MarkupScanner::Markdown, html = MarkupScanner::HTML;
+
+    finds("Markdown link", "See [doc](missing.md).\n", md, {"missing.md"});
+    finds("Markdown image and reference", "![logo](img/logo.png \"Logo\")\n\n[ref]: <docs/a b.md>\n", md,
+          {"img/logo.png", "docs/a b.md"});
+    finds("code span", "`[no](skipped.md)` but [yes](kept.md)\n", md, {"kept.md"});
+    finds("tag in Markdown", "Text <a href=\"a.html\">a</a> and <img\nsrc=\"b.png\"> too\n", md, {"a.html", "b.png"});
+
+    //A '<' in prose, the next '>' is a quote paragraphs later
+    finds("less-than in prose", "if a<b then ok\n\nSee [doc](missing.md).\n\n> quoted\n", md, {"missing.md"});
+    finds("less-than at the end", "x<y\n\n[z](z.md)\n", md, {"z.md"});
+
+    finds("HTML", "<base href=\"/root/\"><a href='x.html#top'>x</a><img src=y.png>", html, {"x.html#top", "y.png"});
+    finds("HTML comment", "<!-- <a href=\"no.html\"> --><a href=\"yes.html\">", html, {"yes.html"});
+
+    if (failures > 0) {
+        cerr << failures << " failed check(s).\n";
+        return 1;
+    }
+    cout << "MarkupScanner finds every link.\n";
+    return 0;
+}
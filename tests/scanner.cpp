@@ -0,0 +1,143 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+/*
+URLScanner against the std::regex it replaced: every URL of a fixed corpus, of seeded random
+lines and of the same texts cut anywhere (a URL at the end of a chunk) must be found at the
+same offset with the same length. Run by ctest, the differences are printed and it fails.
+*/
+
+#include <iostream>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include <scanner.h>
+
+using namespace std;
+
+namespace {
+    //As extractURLS() built it for every line before URLScanner
+    const regex original("(http:\\/\\/|ftp:\\/\\/|https:\\/\\/|www\\.)([\\w_-]+(?:(?:\\.[\\w_-]+)+))([\\w.,@?^=%&:\\/~+#-]*[\\w@?^=%&\\/~+#-])?",
+                         regex_constants::ECMAScript | regex_constants::icase);
+
+    const char *const corpus[] = {
+        "See http://example.com. Then http://example.com, or http://example.com: and http://example.com;",
+        "Trailing http://example.com/path/. and https://example.com/a?b=c&d=e#frag! too",
+        "Wiki (https://en.wikipedia.org/wiki/Foo_(bar)) and [link](http://a.example.org/x)",
+        "www.example.com/path, WWW.EXAMPLE.COM and wWw.Mixed.Case/Path",
+        "HTTP://UPPER.EXAMPLE.COM/X HtTpS://mixed.example.com FTP://ftp.example.org/pub/file.tar.gz",
+        "IPv6: http://[2001:db8::1]:8080/x http://[::1]/ https://[fe80::1%25eth0]/ www.[::1].com",
+        "No host: http://localhost/x http://localhost:8080 http:// https:/a.b ftp:/a.b www.a www..a.b",
+        "Dots: http://a.b..c http://a..b http://.a.b http://a.b.-c/ http://-a.b_c.d",
+        "Glued: xhttp://a.b.c wwww.a.b http://http://a.b.c https://www.a.b/ http://a.b/http://c.d",
+        "Body: https://a-b_c.d-e.f:80/~u/+x@y^z=1%20,:.;",
+        "<a href=\"http://a.b/c\">x</a> 'https://x.y/z' `www.q.r` <http://s.t/u>",
+        "Ends: http://a.b/# http://a.b/? http://a.b/% http://a.b/, http://a.b/: http://a.b/:/",
+        "Bytes: http://\xe4\xbe\x8b\xe3\x81\x88.jp/ http://a.b/\xc3\xa9 http://a.b\xc3\xa9.c\t\r",
+        "h ht htt http http: http:/ w ww www f ft ftp ftp: ftp:/",
+    };
+
+    struct Found
+    {
+        size_t offset, length;
+        bool operator==(const Found &other) const { return offset == other.offset && length == other.length; }
+    };
+
+    vector<Found> withRegex(const string &text)
+    {
+        vector<Found> found;
+        for (sregex_iterator match(text.begin(), text.end(), original), end; match != end; ++match)
+            found.push_back({size_t(match->position(0)), size_t(match->length(0))});
+        return found;
+    }
+
+    vector<Found> withScanner(const string &text)
+    {
+        vector<Found> found;
+        URLMatch match;
+        for (size_t from = 0; URLScanner::find(text.data(), text.size(), from, match); from = match.offset + match.length)
+            found.push_back({match.offset, match.length});
+        return found;
+    }
+
+    size_t failures = 0;
+
+    void print(const char *name, const string &text, const vector<Found> &found)
+    {
+        cerr << "\t" << name << ":";
+        for (const auto &f: found) cerr << " [" << f.offset << "] \"" << text.substr(f.offset, f.length) << "\"";
+        cerr << '\n';
+    }
+
+    void compare(const string &what, const string &text)
+    {
+        const vector<Found> expected = withRegex(text), found = withScanner(text);
+        if (expected == found) return;
+        if (++failures > 20) return;
+        cerr << what << ": \"" << text << "\"\n";
+        print("regex", text, expected);
+        print("scanner", text, found);
+    }
+
+    //Also every way the text can end: the URL at the end of a chunk is cut there
+    void compareCuts(const string &what, const string &text)
+    {
+        for (size_t cut = 0; cut <= text.size(); cut++) compare(what + ", cut at " + to_string(cut), text.substr(0, cut));
+    }
+
+    string randomLine(mt19937 &random)
+    {
+        static const char *const pieces[] = {
+            "http://", "https://", "ftp://", "www.", "HTTP://", "WWW.", "http:/", "ww", ".", ".", ".", "/", "/",
+            ",", ":", ";", "(", ")", "[", "]", "?", "=", "&", "#", "~", "%", "+", "@", "^", "!", "'", "\"",
+            "-", "_", " ", " ", "\t", "a", "b", "z", "Q", "0", "9", "example", "com", "\xc3\xa9",
+        };
+        string line;
+        const size_t count = random() % 60;
+        for (size_t p = 0; p < count; p++) line += pieces[random() % size(pieces)];
+        return line;
+    }
+}
+
+int main()
+{
+    string all;
+    for (const char *line: corpus) {
+        compareCuts("corpus", line);
+        all += line;
+        all += '\n';
+    }
+    compare("corpus, whole", all);
+
+    mt19937 random(2022);
+    string text;
+    for (int l = 0; l < 20000; l++) {
+        const string line = randomLine(random);
+        if (l < 2000) compareCuts("random line " + to_string(l), line);
+        else compare("random line " + to_string(l), line);
+        text += line + '\n';
+    }
+    //Long enough for the vectorized prefilter to run on full blocks
+    compare("random lines, whole", text);
+
+    if (failures > 0) {
+        cerr << failures << " difference(s) between URLScanner and the regex.\n";
+        return 1;
+    }
+    cout << "URLScanner and the regex agree.\n";
+    return 0;
+}
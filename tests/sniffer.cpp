@@ -0,0 +1,90 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+/*
+ContentSniffer on the first block of a file: known binaries are skipped, text that only starts
+like one of their magic numbers is scanned. Run by ctest.
+*/
+
+#include <iostream>
+#include <string>
+
+#include <sniffer.h>
+
+using namespace std;
+
+namespace {
+    size_t failures = 0;
+
+    //"binary" is the format sniff() should name, empty when the block is text
+    void sniffs(const string &what, const string &block, const string &binary)
+    {
+        string format;
+        const ContentSniffer::Kind kind = ContentSniffer::sniff(block.data(), block.size(), format);
+        const bool ok = binary.empty() ? kind == ContentSniffer::Text : kind == ContentSniffer::Binary && format == binary;
+        if (ok) return;
+        failures++;
+        cerr << "FAILED: " << what << " sniffed as " << (kind == ContentSniffer::Text ? "text" : "\"" + format + "\"")
+             << ", expected " << (binary.empty() ? "text" : "\"" + binary + "\"") << '\n';
+    }
+
+    string text(const string &start)
+    {
+        string block = start;
+        while (block.size() < 200) block += " and some more words, see https://example.com/docs.";
+        return block;
+    }
+}
+
+int main()
+{
+    //An MZ text whose PE header offset is close to 4 GiB, it used to wrap and read past the block
+    string mz = text("MZ is short for Mark Zbikowski");
+    mz.replace(60, 4, "\xfd\xff\xff\xff");
+    sniffs("MZ text with a huge header offset", mz, "");
+
+    string pe = text("MZ");
+    pe.replace(60, 4, string("\x80\0\0\0", 4));
+    pe.replace(0x80, 4, string("PE\0\0", 4));
+    sniffs("Windows executable", pe, "Windows executable");
+
+    //Texts starting like a magic number
+    sniffs("ID3 text", text("ID3 tags are read by most players"), "");
+    sniffs("OTTO text", text("OTTO was here"), "");
+    sniffs("OggS text", text("OggS pages"), "");
+    sniffs("fLaC text", text("fLaC files"), "");
+    sniffs("wOFF text", text("wOFF fonts"), "");
+    sniffs("BZh text", text("BZh9 is the best compression level"), "");
+    sniffs("BM text", text("BM is a bitmap"), "");
+    sniffs("SQLite text", text("SQLite format 3 is described in the docs"), "");
+
+    //And the real thing
+    sniffs("ID3v2.4", text(string("ID3\x04\0\0\0\0\x10\x0a", 10)), "MP3 audio");
+    sniffs("OpenType", text(string("OTTO\0\x0c\0\x80\0\x03\0\x20", 12)), "OpenType font");
+    sniffs("Ogg", text(string("OggS\0\x02", 6)), "Ogg media");
+    sniffs("FLAC", text(string("fLaC\0\0\0\x22", 8)), "FLAC audio");
+    sniffs("WOFF", text(string("wOFFOTTO", 8)), "WOFF font");
+    sniffs("WOFF2", text(string("wOF2\0\x01\0\0", 8)), "WOFF2 font");
+    sniffs("bzip2", text("BZh91AY&SY"), "bzip2 archive");
+    sniffs("BMP", text(string("BM\x36\x10\0\0\0\0\0\0\x36\0\0\0", 14)), "BMP image");
+    sniffs("SQLite", text(string("SQLite format 3\0", 16)), "SQLite database");
+
+    if (failures > 0) {
+        cerr << failures << " failed check(s).\n";
+        return 1;
+    }
+    cout << "ContentSniffer tells text from binaries.\n";
+    return 0;
+}
@@ -0,0 +1,90 @@
+/****************************************************************************
+*  Copyright (c) 2022 Xen <xen-dev@pm.me> xen-e.github.io                   *
+*  This file is part of the File URLs Doctor project, AKA FUD               *
+*  FUD is free software; you can redistribute it and/or modify it under     *
+*  the terms of the GNU Lesser General Public License (LGPL) as published   *
+*  by the Free Software Foundation; either version 3 of the License, or     *
+*  (at your option) any later version.                                      *
+*  FUD is distributed in the hope that it will be useful, but WITHOUT       *
+*  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or    *
+*  FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public      *
+*  License for more details.                                                *
+*  You should have received a copy of the GNU Lesser General Public License *
+*  along with this program. If not, see <https://www.gnu.org/licenses>.     *
+*****************************************************************************/
+
+/*
+Duplicates detection of URLIndex: URLs written differently but requested the same way share
+an entry, anything that can lead to another answer doesn't. Run by ctest.
+*/
+
+#include <iostream>
+#include <string>
+
+#include <urlindex.h>
+
+using namespace std;
+
+namespace {
+    size_t failures = 0;
+
+    void check(bool ok, const string &what)
+    {
+        if (ok) return;
+        failures++;
+        cerr << "FAILED: " << what << '\n';
+    }
+
+    //Both URLs added to a new index, "same" when they should end up in one entry
+    void merges(const string &first, const string &second, bool same, bool exact = false)
+    {
+        URLIndex index(exact);
+        index.add({0, 1, 1, first});
+        const bool merged = !index.add({0, 2, 1, second}).second;
+        check(merged == same, "\"" + first + "\" and \"" + second + "\" " + (same ? "should" : "shouldn't") +
+                              " be the same URL" + (exact ? " (exact)" : "") + ", keys \"" + URLIndex::normalize(first) +
+                              "\" and \"" + URLIndex::normalize(second) + "\"");
+    }
+
+    void parts(const string &URL, const string &host, long port)
+    {
+        const URLParts parsed = URLParts::parse(URL);
+        check(parsed.host == host && parsed.port == port, "\"" + URL + "\" parsed as host \"" + parsed.host +
+                                                          "\" port " + to_string(parsed.port));
+    }
+}
+
+int main()
+{
+    merges("HTTP://Example.com:80/docs/#top", "http://example.com/docs", true);
+    merges("https://a.example.com:443/x", "https://a.example.com/x", true);
+    merges("www.example.com/x", "http://www.example.com/x", true);
+    merges("http://example.com:/x", "http://example.com/x", true);
+    merges("http://example.com/x?a=1", "http://example.com/x?a=2", false);
+    merges("http://example.com/X", "http://example.com/x", false);
+    merges("http://example.com:8080/x", "http://example.com/x", false);
+    merges("https://example.com/x", "http://example.com/x", false);
+    merges("HTTP://Example.com/x", "http://example.com/x", false, true);
+
+    //IPv6 hosts keep every group, their port comes after the ']'
+    merges("http://[2001:db8::1]/x", "http://[2001:db8::2]/x", false);
+    merges("http://[2001:db8::1]:8080/x", "http://[2001:db8::1]/x", false);
+    merges("http://[2001:DB8::1]:80/x", "http://[2001:db8::1]/x", true);
+    merges("http://[::1]/", "http://[::2]/", false);
+    parts("http://[2001:db8::1]/x", "[2001:db8::1]", 0);
+    parts("http://[2001:db8::1]:8080/x", "[2001:db8::1]", 8080);
+    parts("http://user@[::1]:81", "[::1]", 81);
+    parts("http://example.com:8080/x", "example.com", 8080);
+    parts("http://example.com:x/", "example.com:x", 0);
+
+    //Anchors of local files are checked one by one
+    merges("file:///docs/a.md#install", "file:///docs/a.md#usage", false);
+    merges("file:///docs/a.md#install", "file:///docs/a.md#install", true);
+
+    if (failures > 0) {
+        cerr << failures << " failed check(s).\n";
+        return 1;
+    }
+    cout << "URLIndex merges what it should.\n";
+    return 0;
+}